@@ -0,0 +1,250 @@
+/* -*- mode: c++; c-basic-offset:4 -*-
+    autotests/certificatefingerprintstest.cpp
+
+    This file is part of Kleopatra's test suite.
+    SPDX-FileCopyrightText: 2024 g10 Code GmbH
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "utils/certificatefingerprints.h"
+
+#include <QCryptographicHash>
+#include <QStringList>
+#include <QTest>
+
+using Fingerprints = QStringList;
+
+namespace
+{
+// minimal DER-encoded SEQUENCEs; the parser only checks the outer structure
+QByteArray shortDER()
+{
+    return QByteArray::fromHex("3003020105");
+}
+
+QByteArray longDER()
+{
+    return QByteArray::fromHex("308180") + QByteArray(128, '\x42');
+}
+
+QByteArray pem(const QByteArray &der, const QByteArray &eol = "\n")
+{
+    QByteArray result = "-----BEGIN CERTIFICATE-----" + eol;
+    const QByteArray base64 = der.toBase64();
+    for (qsizetype i = 0; i < base64.size(); i += 64) {
+        result += base64.mid(i, 64) + eol;
+    }
+    result += "-----END CERTIFICATE-----" + eol;
+    return result;
+}
+
+QString fingerprint(const QByteArray &der)
+{
+    return QString::fromLatin1(QCryptographicHash::hash(der, QCryptographicHash::Sha1).toHex().toUpper());
+}
+
+Fingerprints certificateFingerprints(GpgME::Protocol protocol, const QByteArray &data)
+{
+    Fingerprints fingerprints;
+    for (const auto &fpr : Kleo::certificateFingerprints(protocol, data)) {
+        fingerprints.push_back(QString::fromStdString(fpr));
+    }
+    return fingerprints;
+}
+
+// ed25519 key without subkeys created with gpg (old format packets)
+const QByteArray testKey = QByteArray::fromHex(
+    "9833046592008016092b06010401da470f01010740fc4116cf881747d47e349af260a1193614f999c35afeb1e3479bddd49eccd228b41b54657374204b6579203c746573744065"
+    "78616d706c652e6f72673e889004131608003816210441536e7399c37246753402ec48a5d38b769161cd050265920080021b01050b0908070206150a09080b0204160203010"
+    "21e01021780000a091048a5d38b769161cd8fb80100efe6ef162b3748d537db74c42039ad49f395edb4964b80db30b1e015bc5697c40100be5a081262425b937ce7b47ef20ee"
+    "8aef24f56de01d66af5eda63ea70c2dcd04");
+const QString testKeyFingerprint = QStringLiteral("41536E7399C37246753402EC48A5D38B769161CD");
+
+const QByteArray testKeyArmored =
+    "-----BEGIN PGP PUBLIC KEY BLOCK-----\n"
+    "\n"
+    "mDMEZZIAgBYJKwYBBAHaRw8BAQdA/EEWz4gXR9R+NJryYKEZNhT5mcNa/rHjR5vd\n"
+    "1J7M0ii0G1Rlc3QgS2V5IDx0ZXN0QGV4YW1wbGUub3JnPoiQBBMWCAA4FiEEQVNu\n"
+    "c5nDckZ1NALsSKXTi3aRYc0FAmWSAIACGwEFCwkIBwIGFQoJCAsCBBYCAwECHgEC\n"
+    "F4AACgkQSKXTi3aRYc2PuAEA7+bvFis3SNU323TEIDmtSfOV7bSWS4DbMLHgFbxW\n"
+    "l8QBAL5aCBJiQluTfOe0fvIO6K7yT1beAdZq9e2mPqcMLc0E\n"
+    "=/8D0\n"
+    "-----END PGP PUBLIC KEY BLOCK-----\n";
+
+// ed25519 key with cv25519 subkey created with gpg
+const QByteArray keyWithSubkey = QByteArray::fromHex(
+    "9833046592008016092b06010401da470f01010740556ad3004200b9d033d48bebb8221729afabf0a86c4102c043e7401b8049ed4cb41f5365636f6e64204b6579203c7365636f"
+    "6e64406578616d706c652e6f72673e8890041316080038162104292e5a37a479fb03458a2bfb7f206c8997586d1f050265920080021b03050b0908070206150a09080b02041602"
+    "0301021e01021780000a09107f206c8997586d1f6ba20100cea3a41dba443332b37bd297ffaf061fb0e8e66b348ab0ae092a3e255d05cc820100a70033002dd980cdb3f34aba4f"
+    "8ae9d18d4ab950f57f24ae8acc14b299a94e0bb8380465920080120a2b060104019755010501010740587b0a56e8bccc8367069dc90600c0ca1253ed3fd5b46364faf1f95f7bde"
+    "c728030108078878041816080020162104292e5a37a479fb03458a2bfb7f206c8997586d1f050265920080021b0c000a09107f206c8997586d1f12920100a638cbae3c6941469537"
+    "acc7919c91bd9d6edbfa6c619683cc69820f006bd1160100ef7d68ded9c722eb1dcf41af869b083a4b6d9510bbdef4f5a9383221abac0802");
+const QString keyWithSubkeyFingerprint = QStringLiteral("292E5A37A479FB03458A2BFB7F206C8997586D1F");
+
+// the body of the public key packet of testKey
+QByteArray testKeyPacketBody()
+{
+    return testKey.mid(2, 0x33);
+}
+
+// a synthetic version 5 public key packet (new format)
+const QByteArray v5KeyPacket = QByteArray::fromHex(
+    "c6370565920080160000002d092b06010401da470f01010740000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f");
+const QString v5KeyFingerprint = QStringLiteral("296242A30DF9BCDFED88198AE7514BDDCC9B99C965034D06A05B5209A6D3BE18");
+}
+
+class CertificateFingerprintsTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testOpenPGP_data();
+    void testOpenPGP();
+    void testCMS_data();
+    void testCMS();
+};
+
+void CertificateFingerprintsTest::testOpenPGP_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<Fingerprints>("expected");
+
+    QTest::newRow("empty") //
+        << QByteArray{} //
+        << Fingerprints{};
+    QTest::newRow("garbage") //
+        << QByteArray{"not a key\n-----END PGP PUBLIC KEY BLOCK-----\n"} //
+        << Fingerprints{};
+    QTest::newRow("binary key") //
+        << testKey //
+        << Fingerprints{testKeyFingerprint};
+    QTest::newRow("subkeys are ignored") //
+        << keyWithSubkey //
+        << Fingerprints{keyWithSubkeyFingerprint};
+    QTest::newRow("two binary keys") //
+        << QByteArray{testKey + keyWithSubkey} //
+        << Fingerprints{testKeyFingerprint, keyWithSubkeyFingerprint};
+    QTest::newRow("armored key") //
+        << testKeyArmored //
+        << Fingerprints{testKeyFingerprint};
+    QTest::newRow("armored key with header and CRLF") //
+        << QByteArray{testKeyArmored}.replace("\n\n", "\nComment: foo\n\n").replace("\n", "\r\n") //
+        << Fingerprints{testKeyFingerprint};
+    QTest::newRow("armored keys with text around them") //
+        << QByteArray{"some text\n" + testKeyArmored + "more text\n" + testKeyArmored} //
+        << Fingerprints{testKeyFingerprint, testKeyFingerprint};
+    QTest::newRow("new format packet") //
+        << QByteArray{QByteArray::fromHex("c633") + testKeyPacketBody()} //
+        << Fingerprints{testKeyFingerprint};
+    QTest::newRow("new format packet with five-octet length") //
+        << QByteArray{QByteArray::fromHex("c6ff00000033") + testKeyPacketBody()} //
+        << Fingerprints{testKeyFingerprint};
+    QTest::newRow("version 5 key") //
+        << v5KeyPacket //
+        << Fingerprints{v5KeyFingerprint};
+    QTest::newRow("version 3 key") //
+        << QByteArray{QByteArray::fromHex("9833") + QByteArray{testKeyPacketBody()}.replace(0, 1, "\x03")} //
+        << Fingerprints{};
+    QTest::newRow("truncated key packet") //
+        << testKey.left(40) //
+        << Fingerprints{};
+    QTest::newRow("truncated packet header") //
+        << QByteArray{testKey + keyWithSubkey.left(1)} //
+        << Fingerprints{testKeyFingerprint};
+    QTest::newRow("truncated second key") //
+        << QByteArray{testKey + keyWithSubkey.left(30)} //
+        << Fingerprints{testKeyFingerprint};
+    QTest::newRow("partial body length") //
+        << QByteArray{QByteArray::fromHex("c6e0") + testKeyPacketBody()} //
+        << Fingerprints{};
+    QTest::newRow("indeterminate length") //
+        << QByteArray{QByteArray::fromHex("9b") + testKeyPacketBody()} //
+        << Fingerprints{};
+    QTest::newRow("armor without end line") //
+        << testKeyArmored.chopped(36) //
+        << Fingerprints{};
+    QTest::newRow("armor with invalid base64") //
+        << QByteArray{testKeyArmored}.replace("mDMEZZIA", "mDME*ZIA") //
+        << Fingerprints{};
+    QTest::newRow("secret key block") //
+        << QByteArray{testKeyArmored}.replace("PUBLIC KEY", "PRIVATE KEY") //
+        << Fingerprints{};
+}
+
+void CertificateFingerprintsTest::testOpenPGP()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(Fingerprints, expected);
+
+    QCOMPARE(certificateFingerprints(GpgME::OpenPGP, data), expected);
+}
+
+void CertificateFingerprintsTest::testCMS_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<Fingerprints>("expected");
+
+    QTest::newRow("empty") //
+        << QByteArray{} //
+        << Fingerprints{};
+    QTest::newRow("garbage") //
+        << QByteArray{"\x30\x84\xff\xff\xff\xff not PEM at all\n-----END"} //
+        << Fingerprints{};
+    QTest::newRow("one certificate") //
+        << pem(shortDER()) //
+        << Fingerprints{fingerprint(shortDER())};
+    QTest::newRow("CRLF line endings") //
+        << pem(shortDER(), "\r\n") //
+        << Fingerprints{fingerprint(shortDER())};
+    QTest::newRow("long form length") //
+        << pem(longDER()) //
+        << Fingerprints{fingerprint(longDER())};
+    QTest::newRow("two certificates with text around them") //
+        << QByteArray{"Subject: foo\n" + pem(shortDER()) + "some text\n" + pem(longDER())} //
+        << Fingerprints{fingerprint(shortDER()), fingerprint(longDER())};
+    QTest::newRow("X509 CERTIFICATE marker and header") //
+        << QByteArray{"-----BEGIN X509 CERTIFICATE-----\nProc-Type: 4,CRL\n\n" + shortDER().toBase64() + "\n-----END X509 CERTIFICATE-----\n"} //
+        << Fingerprints{fingerprint(shortDER())};
+    QTest::newRow("other PEM block") //
+        << QByteArray{pem(shortDER()).replace("CERTIFICATE", "PUBLIC KEY")} //
+        << Fingerprints{};
+    QTest::newRow("missing end line") //
+        << pem(shortDER()).chopped(26) //
+        << Fingerprints{};
+    QTest::newRow("missing end line followed by certificate") //
+        << QByteArray{pem(longDER()).chopped(26) + pem(shortDER())} //
+        << Fingerprints{fingerprint(shortDER())};
+    QTest::newRow("truncated base64") //
+        << QByteArray{"-----BEGIN CERTIFICATE-----\n" + longDER().toBase64().left(64) + "\n-----END CERTIFICATE-----\n"} //
+        << Fingerprints{};
+    QTest::newRow("invalid base64") //
+        << QByteArray{"-----BEGIN CERTIFICATE-----\nMAMCAQ*F\n-----END CERTIFICATE-----\n"} //
+        << Fingerprints{};
+    QTest::newRow("DER length too large") //
+        << pem(QByteArray::fromHex("3004020105")) //
+        << Fingerprints{};
+    QTest::newRow("DER with trailing data") //
+        << pem(shortDER() + QByteArray(1, '\0')) //
+        << Fingerprints{};
+    QTest::newRow("truncated DER length") //
+        << pem(QByteArray::fromHex("3082")) //
+        << Fingerprints{};
+    QTest::newRow("indefinite DER length") //
+        << pem(QByteArray::fromHex("30800201050000")) //
+        << Fingerprints{};
+    QTest::newRow("not a SEQUENCE") //
+        << pem(QByteArray::fromHex("0403010203")) //
+        << Fingerprints{};
+}
+
+void CertificateFingerprintsTest::testCMS()
+{
+    QFETCH(QByteArray, data);
+    QFETCH(Fingerprints, expected);
+
+    QCOMPARE(certificateFingerprints(GpgME::CMS, data), expected);
+}
+
+QTEST_MAIN(CertificateFingerprintsTest)
+#include "certificatefingerprintstest.moc"
@@ -0,0 +1,206 @@
+/* -*- mode: c++; c-basic-offset:4 -*-
+    autotests/taskprogressaggregatortest.cpp
+
+    This file is part of Kleopatra's test suite.
+    SPDX-FileCopyrightText: 2024 g10 Code GmbH
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "crypto/taskprogressaggregator.h"
+
+#include <QElapsedTimer>
+#include <QSignalSpy>
+#include <QTest>
+
+#include <vector>
+
+using namespace Kleo::Crypto;
+
+class TaskProgressAggregatorTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testNoTasks();
+    void testSumOfTasks();
+    void testUnknownTaskIsIgnored();
+    void testReAddingTaskResetsProgress();
+    void testTotalBecomesKnownAndUnknownAgain();
+
+    void testFirstRequestIsAnsweredImmediately();
+    void testRequestsAreCoalesced();
+    void testFlushWithoutPendingRequest();
+    void testFlushWithPendingRequest();
+    void testAtMostOneEmissionPerInterval();
+};
+
+void TaskProgressAggregatorTest::testNoTasks()
+{
+    TaskProgressAggregator aggregator;
+
+    QCOMPARE(aggregator.processed(), quint64{0});
+    QCOMPARE(aggregator.total(), quint64{0});
+    QVERIFY(aggregator.totalIsKnown());
+}
+
+void TaskProgressAggregatorTest::testSumOfTasks()
+{
+    TaskProgressAggregator aggregator;
+    aggregator.addTask(1);
+    aggregator.addTask(2);
+    QVERIFY(!aggregator.totalIsKnown());
+
+    aggregator.setProgress(1, 10, 100);
+    QCOMPARE(aggregator.processed(), quint64{10});
+    QCOMPARE(aggregator.total(), quint64{100});
+    QVERIFY(!aggregator.totalIsKnown());
+
+    aggregator.setProgress(2, 5, 50);
+    aggregator.setProgress(1, 40, 100);
+    QCOMPARE(aggregator.processed(), quint64{45});
+    QCOMPARE(aggregator.total(), quint64{150});
+    QVERIFY(aggregator.totalIsKnown());
+}
+
+void TaskProgressAggregatorTest::testUnknownTaskIsIgnored()
+{
+    TaskProgressAggregator aggregator;
+    aggregator.addTask(1);
+
+    aggregator.setProgress(2, 10, 100);
+    QCOMPARE(aggregator.processed(), quint64{0});
+    QCOMPARE(aggregator.total(), quint64{0});
+    QVERIFY(!aggregator.totalIsKnown());
+}
+
+void TaskProgressAggregatorTest::testReAddingTaskResetsProgress()
+{
+    TaskProgressAggregator aggregator;
+    aggregator.addTask(1);
+    aggregator.addTask(2);
+    aggregator.setProgress(1, 10, 100);
+    aggregator.setProgress(2, 20, 200);
+    QVERIFY(aggregator.totalIsKnown());
+
+    aggregator.addTask(1);
+    QCOMPARE(aggregator.processed(), quint64{20});
+    QCOMPARE(aggregator.total(), quint64{200});
+    QVERIFY(!aggregator.totalIsKnown());
+
+    // re-adding a task without total must not count it twice
+    aggregator.addTask(1);
+    aggregator.setProgress(1, 30, 300);
+    QCOMPARE(aggregator.processed(), quint64{50});
+    QCOMPARE(aggregator.total(), quint64{500});
+    QVERIFY(aggregator.totalIsKnown());
+}
+
+void TaskProgressAggregatorTest::testTotalBecomesKnownAndUnknownAgain()
+{
+    TaskProgressAggregator aggregator;
+    aggregator.addTask(1);
+    aggregator.setProgress(1, 10, 0);
+    QCOMPARE(aggregator.processed(), quint64{10});
+    QVERIFY(!aggregator.totalIsKnown());
+
+    aggregator.setProgress(1, 20, 100);
+    QCOMPARE(aggregator.total(), quint64{100});
+    QVERIFY(aggregator.totalIsKnown());
+
+    aggregator.setProgress(1, 30, 0);
+    QCOMPARE(aggregator.processed(), quint64{30});
+    QCOMPARE(aggregator.total(), quint64{0});
+    QVERIFY(!aggregator.totalIsKnown());
+
+    aggregator.setProgress(1, 40, 100);
+    QCOMPARE(aggregator.processed(), quint64{40});
+    QCOMPARE(aggregator.total(), quint64{100});
+    QVERIFY(aggregator.totalIsKnown());
+}
+
+void TaskProgressAggregatorTest::testFirstRequestIsAnsweredImmediately()
+{
+    RateLimiter limiter{10};
+    QSignalSpy spy{&limiter, &RateLimiter::triggered};
+
+    limiter.request();
+    QCOMPARE(spy.count(), 1);
+}
+
+void TaskProgressAggregatorTest::testRequestsAreCoalesced()
+{
+    RateLimiter limiter{10};
+    QSignalSpy spy{&limiter, &RateLimiter::triggered};
+
+    for (int i = 0; i < 100; ++i) {
+        limiter.request();
+    }
+    QCOMPARE(spy.count(), 1);
+
+    // the pending requests are answered with one emission after the interval
+    QVERIFY(spy.wait(1000));
+    QCOMPARE(spy.count(), 2);
+    QTest::qWait(250);
+    QCOMPARE(spy.count(), 2);
+}
+
+void TaskProgressAggregatorTest::testFlushWithoutPendingRequest()
+{
+    RateLimiter limiter{10};
+    QSignalSpy spy{&limiter, &RateLimiter::triggered};
+
+    limiter.flush();
+    QCOMPARE(spy.count(), 0);
+
+    limiter.request();
+    limiter.flush();
+    QCOMPARE(spy.count(), 1);
+    QTest::qWait(250);
+    QCOMPARE(spy.count(), 1);
+}
+
+void TaskProgressAggregatorTest::testFlushWithPendingRequest()
+{
+    RateLimiter limiter{10};
+    QSignalSpy spy{&limiter, &RateLimiter::triggered};
+
+    limiter.request();
+    limiter.request();
+    QCOMPARE(spy.count(), 1);
+
+    limiter.flush();
+    QCOMPARE(spy.count(), 2);
+
+    // the flushed request must not be answered a second time
+    QTest::qWait(250);
+    QCOMPARE(spy.count(), 2);
+}
+
+void TaskProgressAggregatorTest::testAtMostOneEmissionPerInterval()
+{
+    static const int maxPerSecond = 20;
+    static const int intervalInMilliseconds = 1000 / maxPerSecond;
+    RateLimiter limiter{maxPerSecond};
+    QElapsedTimer timer;
+    timer.start();
+    std::vector<qint64> emissionTimes;
+    connect(&limiter, &RateLimiter::triggered, this, [&timer, &emissionTimes]() {
+        emissionTimes.push_back(timer.elapsed());
+    });
+
+    while (timer.elapsed() < 500) {
+        limiter.request();
+        QTest::qWait(1);
+    }
+
+    QVERIFY(emissionTimes.size() >= 2);
+    for (std::size_t i = 1; i < emissionTimes.size(); ++i) {
+        const qint64 gap = emissionTimes[i] - emissionTimes[i - 1];
+        // allow for the inaccuracy of coarse timers (up to 5 %)
+        QVERIFY2(gap >= intervalInMilliseconds * 9 / 10, qPrintable(QStringLiteral("emission %1 after %2 ms").arg(i).arg(gap)));
+    }
+}
+
+QTEST_MAIN(TaskProgressAggregatorTest)
+#include "taskprogressaggregatortest.moc"
@@ -18,6 +18,8 @@
 #include "dialogs/certifycertificatedialog.h"
 #include "exportopenpgpcertstoservercommand.h"
 
+#include <utils/keycacheupdater.h>
+
 #include <Libkleo/Algorithm>
 #include <Libkleo/Compat>
 #include <Libkleo/Formatting>
@@ -62,12 +64,14 @@ private:
 private:
     void ensureDialogCreated();
     void createJob();
+    void showResult(const Error &err);
 
 private:
     GpgME::Key target;
     std::vector<UserID> uids;
     QPointer<CertifyCertificateDialog> dialog;
     QPointer<QGpgME::SignKeyJob> job;
+    std::shared_ptr<KeyCacheAutoRefreshSuspension> keyCacheAutoRefreshSuspension;
 };
 
 CertifyCertificateCommand::Private *CertifyCertificateCommand::d_func()
@@ -221,6 +225,23 @@ void CertifyCertificateCommand::Private::slotDialogRejected()
 }
 
 void CertifyCertificateCommand::Private::slotResult(const Error &err)
+{
+    if (err) {
+        keyCacheAutoRefreshSuspension.reset();
+        showResult(err);
+        finished();
+        return;
+    }
+    // relist only the certified certificate; the automatic refresh stays
+    // suspended until the key cache has been updated
+    updateKeysInKeyCache(GpgME::OpenPGP, {target.primaryFingerprint()}, q, [this, err]() {
+        keyCacheAutoRefreshSuspension.reset();
+        showResult(err);
+        finished();
+    });
+}
+
+void CertifyCertificateCommand::Private::showResult(const Error &err)
 {
     if (err.isCanceled()) {
         // do nothing
@@ -236,8 +257,6 @@ void CertifyCertificateCommand::Private::slotResult(const Error &err)
     } else {
         information(i18n("Certification successful."), i18n("Certification Succeeded"));
     }
-
-    finished();
 }
 
 void CertifyCertificateCommand::Private::slotCertificationPrepared()
@@ -275,6 +294,7 @@ void CertifyCertificateCommand::Private::slotCertificationPrepared()
         job->setExpirationDate(dialog->expirationDate());
     }
 
+    keyCacheAutoRefreshSuspension = KeyCache::mutableInstance()->suspendAutoRefresh();
     if (const Error err = job->start(target)) {
         slotResult(err);
     }
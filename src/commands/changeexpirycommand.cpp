@@ -16,8 +16,11 @@
 
 #include "dialogs/expirydialog.h"
 
+#include <utils/keycacheupdater.h>
+
 #include <Libkleo/Expiration>
 #include <Libkleo/Formatting>
+#include <Libkleo/KeyCache>
 
 #include <KLocalizedString>
 
@@ -98,6 +101,7 @@ private:
     GpgME::Subkey subkey;
     QPointer<ExpiryDialog> dialog;
     QPointer<ChangeExpiryJob> job;
+    std::shared_ptr<KeyCacheAutoRefreshSuspension> keyCacheAutoRefreshSuspension;
 };
 
 ChangeExpiryCommand::Private *ChangeExpiryCommand::d_func()
@@ -157,7 +161,9 @@ void ChangeExpiryCommand::Private::slotDialogAccepted()
         }
     }
 
+    keyCacheAutoRefreshSuspension = KeyCache::mutableInstance()->suspendAutoRefresh();
     if (const Error err = job->start(key, expiry, subkeysToUpdate)) {
+        keyCacheAutoRefreshSuspension.reset();
         showErrorDialog(err);
         finished();
     }
@@ -171,14 +177,21 @@ void ChangeExpiryCommand::Private::slotDialogRejected()
 
 void ChangeExpiryCommand::Private::slotResult(const Error &err)
 {
-    if (err.isCanceled())
-        ;
-    else if (err) {
-        showErrorDialog(err);
-    } else {
-        showSuccessDialog();
+    if (err) {
+        keyCacheAutoRefreshSuspension.reset();
+        if (!err.isCanceled()) {
+            showErrorDialog(err);
+        }
+        finished();
+        return;
     }
-    finished();
+    // relist only the changed certificate; the automatic refresh stays
+    // suspended until the key cache has been updated
+    updateKeysInKeyCache(key.protocol(), {key.primaryFingerprint()}, q, [this]() {
+        keyCacheAutoRefreshSuspension.reset();
+        showSuccessDialog();
+        finished();
+    });
 }
 
 void ChangeExpiryCommand::Private::ensureDialogCreated(ExpiryDialog::Mode mode)
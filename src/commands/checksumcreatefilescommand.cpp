@@ -17,6 +17,8 @@
 
 #include <utils/filedialog.h>
 
+#include "fileoperationspreferences.h"
+
 #include <Libkleo/Stl_Util>
 
 #include "kleopatra_debug.h"
@@ -79,6 +81,7 @@ ChecksumCreateFilesCommand::Private::Private(ChecksumCreateFilesCommand *qq, Key
     , controller()
 {
     controller.setAllowAddition(true);
+    controller.setIncremental(FileOperationsPreferences().incrementalChecksums());
 }
 
 ChecksumCreateFilesCommand::Private::~Private()
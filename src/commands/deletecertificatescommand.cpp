@@ -101,6 +101,7 @@ public:
 private:
     QPointer<DeleteCertificatesDialog> dialog;
     QPointer<MultiDeleteJob> cmsJob, pgpJob;
+    std::shared_ptr<KeyCacheAutoRefreshSuspension> keyCacheAutoRefreshSuspension;
     GpgME::Error cmsError, pgpError;
     std::vector<Key> cmsKeys, pgpKeys;
 };
@@ -286,6 +287,10 @@ void DeleteCertificatesCommand::Private::slotDialogAccepted()
     pgpKeys.swap(openpgp);
     cmsKeys.swap(cms);
 
+    // the deleted certificates are removed from the key cache; there is no
+    // need to reload all certificates when the keyring changes
+    keyCacheAutoRefreshSuspension = KeyCache::mutableInstance()->suspendAutoRefresh();
+
     if (!pgpKeys.empty()) {
         startDeleteJob(GpgME::OpenPGP);
     }
@@ -352,6 +357,7 @@ void DeleteCertificatesCommand::Private::showErrorsAndFinish()
         keys.insert(keys.end(), cmsKeys.begin(), cmsKeys.end());
         KeyCache::mutableInstance()->remove(keys);
     }
+    keyCacheAutoRefreshSuspension.reset();
 
     finished();
 }
@@ -34,12 +34,112 @@
 
 #include <KSharedConfig>
 
+#include <map>
 #include <memory>
+#include <utility>
+#include <vector>
 
 using namespace GpgME;
 using namespace Kleo;
 using namespace QGpgME;
 
+namespace
+{
+// number of bytes at the beginning of a file that are inspected to decide
+// which backend(s) the file is passed to
+static const qint64 sniffSize = 4096;
+
+bool looksLikeDER(const QByteArray &head)
+{
+    // X.509 certificates, PKCS#7 bundles and PKCS#12 files start with an
+    // ASN.1 SEQUENCE with a short, long, or indefinite length
+    return head.size() >= 2 //
+        && static_cast<unsigned char>(head[0]) == 0x30 //
+        && static_cast<unsigned char>(head[1]) <= 0x84;
+}
+
+bool looksLikeOpenPGPPacket(const QByteArray &head)
+{
+    if (head.isEmpty()) {
+        return false;
+    }
+    const auto c = static_cast<unsigned char>(head[0]);
+    if (!(c & 0x80)) {
+        return false;
+    }
+    // new format packets have the tag in the lower 6 bits, old format
+    // packets in bits 2 to 5
+    const unsigned int tag = (c & 0x40) ? (c & 0x3f) : ((c >> 2) & 0x0f);
+    // transferable keys start with a (secret) key packet; revocation
+    // certificates consist of a signature packet
+    return tag == 2 || tag == 5 || tag == 6;
+}
+
+// kinds of content that can be imported together with other files of the
+// same kind by concatenating the files
+enum class ContentKind {
+    Other,
+    ArmoredOpenPGPKeys,
+    BinaryOpenPGPKeys,
+    PEMCertificates,
+};
+
+struct ContentInfo {
+    std::vector<GpgME::Protocol> protocols;
+    ContentKind kind = ContentKind::Other;
+};
+
+ContentInfo inspectContent(QByteArray head)
+{
+    if (const auto encoding = QStringDecoder::encodingForData(head)) {
+        QStringDecoder codec(*encoding);
+        head = QString(codec.decode(head)).toUtf8();
+    }
+    const unsigned int classification = classifyContent(head);
+    const bool isArmoredCertificate = (classification & Class::Ascii) && (classification & Class::TypeMask) == Class::Certificate;
+    if (isOpenPGP(classification) && !isCMS(classification)) {
+        return {{GpgME::OpenPGP}, isArmoredCertificate ? ContentKind::ArmoredOpenPGPKeys : ContentKind::Other};
+    }
+    if (isCMS(classification) && !isOpenPGP(classification)) {
+        return {{GpgME::CMS}, isArmoredCertificate ? ContentKind::PEMCertificates : ContentKind::Other};
+    }
+    if (looksLikeOpenPGPPacket(head)) {
+        const auto c = static_cast<unsigned char>(head[0]);
+        const unsigned int tag = (c & 0x40) ? (c & 0x3f) : ((c >> 2) & 0x0f);
+        // public keys only; secret keys may need to be unlocked and
+        // revocation certificates are rare
+        return {{GpgME::OpenPGP}, tag == 6 ? ContentKind::BinaryOpenPGPKeys : ContentKind::Other};
+    }
+    if (looksLikeDER(head)) {
+        // DER-encoded objects cannot be concatenated
+        return {{GpgME::CMS}, ContentKind::Other};
+    }
+    // we cannot tell; let both backends have a go
+    return {{GpgME::OpenPGP, GpgME::CMS}, ContentKind::Other};
+}
+
+// files of the same kind are imported in batches with a single backend
+// operation instead of one operation per file; only small files are batched
+// because the files of a batch are read a second time to attribute the
+// imported certificates to the files
+static const qint64 maxBatchedFileSize = 1024 * 1024;
+static const qint64 maxBatchSize = 16 * 1024 * 1024;
+static const qsizetype maxFilesPerBatch = 1000;
+
+struct Batch {
+    QStringList fileNames;
+    qint64 size = 0;
+};
+
+QString batchId(const QStringList &fileNames)
+{
+    if (fileNames.size() == 1) {
+        return fileNames.front();
+    }
+    return i18np("%2 and 1 other file", "%2 and %1 other files", fileNames.size() - 1, fileNames.front());
+}
+}
+
 class ImportCertificateFromFileCommand::Private : public ImportCertificatesCommand::Private
 {
     friend class ::ImportCertificateFromFileCommand;
@@ -129,6 +229,13 @@ void ImportCertificateFromFileCommand::doStart()
 
     // TODO: use KIO here
     d->setWaitForMoreJobs(true);
+    std::map<std::pair<GpgME::Protocol, ContentKind>, Batch> batches;
+    const auto startBatch = [this](GpgME::Protocol protocol, Batch &batch) {
+        if (!batch.fileNames.empty()) {
+            d->startImportFromFiles(protocol, batch.fileNames, batchId(batch.fileNames));
+            batch = {};
+        }
+    };
     for (const QString &fn : std::as_const(d->files)) {
         QFile in(fn);
         if (!in.open(QIODevice::ReadOnly)) {
@@ -136,19 +243,31 @@ void ImportCertificateFromFileCommand::doStart()
             d->addImportResult({fn, GpgME::UnknownProtocol, ImportType::Local, ImportResult{}, AuditLogEntry{}});
             continue;
         }
-        auto data = in.readAll();
-        // check for UTF-16- (or UTF-32- or UTF-8-with-BOM-)encoded text file;
-        // binary certificate files don't start with a BOM, so that it's safe
-        // to assume that data starting with a BOM is UTF-encoded text
-        if (const auto encoding = QStringDecoder::encodingForData(data)) {
-            QStringDecoder codec(*encoding);
-            qCDebug(KLEOPATRA_LOG) << this << __func__ << "Decoding" << codec.name() << "encoded data";
-            data = QString(codec.decode(data)).toUtf8();
+        const auto content = inspectContent(in.read(sniffSize));
+        const qint64 fileSize = in.size();
+        in.close();
+        // the content of the file is streamed to the backends when the
+        // import jobs are started
+        if (content.kind != ContentKind::Other && content.protocols.size() == 1 && fileSize <= maxBatchedFileSize) {
+            const auto protocol = content.protocols.front();
+            auto &batch = batches[{protocol, content.kind}];
+            if (batch.fileNames.size() >= maxFilesPerBatch || batch.size + fileSize > maxBatchSize) {
+                startBatch(protocol, batch);
+            }
+            batch.fileNames.push_back(fn);
+            batch.size += fileSize;
+        } else {
+            qCDebug(KLEOPATRA_LOG) << this << __func__ << "Importing" << fn << "with" << content.protocols.size() << "backend(s)";
+            for (const auto protocol : content.protocols) {
+                d->startImportFromFile(protocol, fn);
+            }
         }
-        d->startImport(GpgME::OpenPGP, data, fn);
-        d->startImport(GpgME::CMS, data, fn);
         d->importGroupsFromFile(fn);
     }
+    for (auto &[key, batch] : batches) {
+        qCDebug(KLEOPATRA_LOG) << this << __func__ << "Importing" << batch.fileNames.size() << "file(s) with one job";
+        startBatch(key.first, batch);
+    }
     d->setWaitForMoreJobs(false);
 }
 
@@ -17,8 +17,10 @@
 #include "importcertificatescommand_p.h"
 
 #include "certifycertificatecommand.h"
+#include "importfromfilejob.h"
 #include "kleopatra_debug.h"
 #include <settings.h>
+#include <utils/keycacheupdater.h>
 #include <utils/memory-helpers.h>
 
 #include <Libkleo/Algorithm>
@@ -76,6 +78,32 @@ bool operator==(const ImportJobData &lhs, const ImportJobData &rhs)
     return lhs.job == rhs.job;
 }
 
+static void startJob(QObject *job)
+{
+    if (auto fileJob = qobject_cast<ImportFromFileJob *>(job)) {
+        fileJob->startNow();
+    } else if (auto gpgmeJob = qobject_cast<QGpgME::Job *>(job)) {
+        gpgmeJob->startNow();
+    }
+}
+
+static void cancelJob(QObject *job)
+{
+    if (auto fileJob = qobject_cast<ImportFromFileJob *>(job)) {
+        fileJob->slotCancel();
+    } else if (auto gpgmeJob = qobject_cast<QGpgME::Job *>(job)) {
+        gpgmeJob->slotCancel();
+    }
+}
+
+static AuditLogEntry auditLogOfJob(const QObject *job)
+{
+    if (auto fileJob = qobject_cast<const ImportFromFileJob *>(job)) {
+        return fileJob->auditLog();
+    }
+    return AuditLogEntry::fromJob(qobject_cast<const QGpgME::Job *>(job));
+}
+
 namespace
 {
 
@@ -156,7 +184,12 @@ private:
             const std::vector<Import> imports = r.result.imports();
             m_importsByFingerprint.insert(m_importsByFingerprint.end(), imports.begin(), imports.end());
             for (std::vector<Import>::const_iterator it = imports.begin(), end = imports.end(); it != end; ++it) {
-                m_idsByFingerprint[it->fingerprint()].insert(r.id);
+                const auto sources = it->fingerprint() ? r.idsByFingerprint.find(it->fingerprint()) : r.idsByFingerprint.end();
+                if (sources != r.idsByFingerprint.end()) {
+                    m_idsByFingerprint[it->fingerprint()].insert(sources->second.cbegin(), sources->second.cend());
+                } else {
+                    m_idsByFingerprint[it->fingerprint()].insert(r.id);
+                }
             }
         }
         std::sort(m_importsByFingerprint.begin(), m_importsByFingerprint.end(), ByImportFingerprint<std::less>());
@@ -231,9 +264,20 @@ static QString make_tooltip(const std::vector<ImportResultData> &results)
 
     std::vector<QString> ids;
     ids.reserve(results.size());
-    std::transform(std::begin(results), std::end(results), std::back_inserter(ids), [](const auto &r) {
-        return r.id;
-    });
+    for (const auto &r : results) {
+        if (r.idsByFingerprint.empty()) {
+            ids.push_back(r.id);
+            continue;
+        }
+        for (const auto &import : r.result.imports()) {
+            const auto sources = import.fingerprint() ? r.idsByFingerprint.find(import.fingerprint()) : r.idsByFingerprint.end();
+            if (sources != r.idsByFingerprint.end()) {
+                ids.insert(ids.end(), sources->second.cbegin(), sources->second.cend());
+            } else {
+                ids.push_back(r.id);
+            }
+        }
+    }
     std::sort(std::begin(ids), std::end(ids));
     ids.erase(std::unique(std::begin(ids), std::end(ids)), std::end(ids));
 
@@ -535,10 +579,10 @@ void ImportCertificatesCommand::Private::setWaitForMoreJobs(bool wait)
     }
 }
 
-void ImportCertificatesCommand::Private::onImportResult(const ImportResult &result, QGpgME::Job *finishedJob)
+void ImportCertificatesCommand::Private::onImportResult(const ImportResult &result, QObject *finishedJob)
 {
     if (!finishedJob) {
-        finishedJob = qobject_cast<QGpgME::Job *>(q->sender());
+        finishedJob = q->sender();
     }
     Q_ASSERT(finishedJob);
     qCDebug(KLEOPATRA_LOG) << q << __func__ << finishedJob;
@@ -558,7 +602,38 @@ void ImportCertificatesCommand::Private::onImportResult(const ImportResult &resu
     increaseProgressValue();
 
     const auto job = *it;
-    addImportResult({job.id, job.protocol, job.type, result, AuditLogEntry::fromJob(finishedJob)}, job);
+    ImportResultData resultData{job.id, job.protocol, job.type, result, auditLogOfJob(finishedJob)};
+    if (auto fileJob = qobject_cast<const ImportFromFileJob *>(finishedJob)) {
+        QStringList readFileNames = fileJob->fileNames();
+        for (const auto &[fileName, errorString] : fileJob->fileErrors()) {
+            error(i18n("Could not open file %1 for reading: %2", fileName, errorString), i18n("Certificate Import Failed"));
+            addImportResult({fileName, job.protocol, job.type, ImportResult{}, AuditLogEntry{}});
+            readFileNames.removeOne(fileName);
+        }
+        if (readFileNames.empty()) {
+            std::erase(runningJobs, job);
+            tryToFinish();
+            return;
+        }
+        if (readFileNames.size() > 1 && result.error() && !result.error().isCanceled()) {
+            // a single broken file (e.g. a truncated armor block) makes the
+            // import of all files of a batch fail; retry them one by one, so
+            // that we get the certificates of the other files and can tell
+            // which file is broken
+            qCDebug(KLEOPATRA_LOG) << q << __func__ << "Importing" << readFileNames.size() << "files one by one after error:" << Formatting::errorAsString(result.error());
+            for (const QString &fileName : std::as_const(readFileNames)) {
+                startImportFromFile(job.protocol, fileName);
+            }
+            std::erase(runningJobs, job);
+            tryToFinish();
+            return;
+        }
+        if (readFileNames.size() == 1) {
+            resultData.id = readFileNames.front();
+        }
+        resultData.idsByFingerprint = fileJob->fileNamesByFingerprint();
+    }
+    addImportResult(resultData, job);
 }
 
 void ImportCertificatesCommand::Private::addImportResult(const ImportResultData &result, const ImportJobData &job)
@@ -749,28 +824,47 @@ void ImportCertificatesCommand::Private::tryToFinish()
         qCDebug(KLEOPATRA_LOG) << q << __func__ << "There are pending jobs -> start the next one";
         auto job = pendingJobs.front();
         pendingJobs.pop();
-        job.job->startNow();
+        startJob(job.job);
         runningJobs.push_back(job);
         return;
     }
 
-    if (keyListConnection) {
-        qCWarning(KLEOPATRA_LOG) << q << __func__ << "There is already a valid keyListConnection!";
-    } else {
-        auto keyCache = KeyCache::mutableInstance();
-        keyListConnection = connect(keyCache.get(), &KeyCache::keyListingDone, q, [this]() {
-            keyCacheUpdated();
+    if (pendingKeyCacheUpdates > 0) {
+        qCWarning(KLEOPATRA_LOG) << q << __func__ << "The key cache is already being updated!";
+        return;
+    }
+
+    // relist only the imported certificates instead of reloading the key cache
+    std::map<GpgME::Protocol, std::set<std::string>> importedFingerprints;
+    for (const auto &r : results) {
+        for (const auto &import : r.result.imports()) {
+            if (!import.error() && import.fingerprint()) {
+                importedFingerprints[r.protocol].insert(import.fingerprint());
+            }
+        }
+    }
+    if (importedFingerprints.empty()) {
+        QMetaObject::invokeMethod(
+            q,
+            [this]() {
+                keyCacheUpdated();
+            },
+            Qt::QueuedConnection);
+        return;
+    }
+    pendingKeyCacheUpdates = importedFingerprints.size();
+    for (const auto &[protocol, fingerprints] : importedFingerprints) {
+        updateKeysInKeyCache(protocol, {fingerprints.begin(), fingerprints.end()}, q, [this]() {
+            if (--pendingKeyCacheUpdates == 0) {
+                keyCacheUpdated();
+            }
         });
-        keyCache->startKeyListing();
     }
 }
 
 void ImportCertificatesCommand::Private::keyCacheUpdated()
 {
     qCDebug(KLEOPATRA_LOG) << q << __func__;
-    if (!disconnect(keyListConnection)) {
-        qCWarning(KLEOPATRA_LOG) << q << __func__ << "Failed to disconnect keyListConnection";
-    }
 
     keyCacheAutoRefreshSuspension.reset();
 
@@ -935,6 +1029,47 @@ void ImportCertificatesCommand::Private::startImport(GpgME::Protocol protocol,
     }
 }
 
+void ImportCertificatesCommand::Private::startImportFromFile(GpgME::Protocol protocol, const QString &fileName)
+{
+    startImportFromFiles(protocol, {fileName}, fileName);
+}
+
+void ImportCertificatesCommand::Private::startImportFromFiles(GpgME::Protocol protocol, const QStringList &fileNames, const QString &id)
+{
+    Q_ASSERT(protocol != UnknownProtocol);
+    Q_ASSERT(!fileNames.empty());
+
+    if (std::find(nonWorkingProtocols.cbegin(), nonWorkingProtocols.cend(), protocol) != nonWorkingProtocols.cend()) {
+        return;
+    }
+
+    if (!(protocol == GpgME::OpenPGP ? QGpgME::openpgp() : QGpgME::smime())) {
+        nonWorkingProtocols.push_back(protocol);
+        error(i18n("The type of this certificate (%1) is not supported by this Kleopatra installation.", Formatting::displayName(protocol)),
+              i18n("Certificate Import Failed"));
+        addImportResult({id, protocol, ImportType::Local, ImportResult{}, AuditLogEntry{}});
+        return;
+    }
+
+    keyCacheAutoRefreshSuspension = KeyCache::mutableInstance()->suspendAutoRefresh();
+
+    // the files are only opened when the job is started, so that the number
+    // of open files doesn't depend on the number of files to import
+    auto job = new ImportFromFileJob{protocol, fileNames};
+    std::vector<QMetaObject::Connection> connections = {
+        connect(job,
+                &ImportFromFileJob::result,
+                q,
+                [this](const GpgME::ImportResult &result) {
+                    onImportResult(result);
+                }),
+        connect(job, &ImportFromFileJob::jobProgress, q, &Command::progress),
+    };
+
+    increaseProgressMaximum();
+    pendingJobs.push({id, protocol, ImportType::Local, job, connections});
+}
+
 static std::unique_ptr<ImportFromKeyserverJob> get_import_from_keyserver_job(GpgME::Protocol protocol)
 {
     Q_ASSERT(protocol != UnknownProtocol);
@@ -1096,7 +1231,7 @@ void ImportCertificatesCommand::doCancel()
         if (!job.connections.empty()) {
             // ignore jobs without connections; they are already completed
             qCDebug(KLEOPATRA_LOG) << "Canceling job" << job.job;
-            job.job->slotCancel();
+            cancelJob(job.job);
             d->onImportResult(ImportResult{Error::fromCode(GPG_ERR_CANCELED)}, job.job);
         }
     });
@@ -22,6 +22,7 @@
 
 #include <map>
 #include <queue>
+#include <string>
 #include <vector>
 
 namespace GpgME
@@ -54,7 +55,8 @@ struct ImportJobData {
     QString id;
     GpgME::Protocol protocol = GpgME::UnknownProtocol;
     ImportType type = ImportType::Unknown;
-    QGpgME::Job *job = nullptr;
+    // a QGpgME::Job or a Kleo::ImportFromFileJob
+    QObject *job = nullptr;
     std::vector<QMetaObject::Connection> connections;
 };
 
@@ -66,6 +68,10 @@ struct ImportResultData {
     ImportType type = ImportType::Unknown;
     GpgME::ImportResult result;
     Kleo::AuditLogEntry auditLog;
+    // for imports of several sources with a single job: the sources the
+    // imported certificates (by fingerprint) came from; imports not listed
+    // here are attributed to id
+    std::map<std::string, QStringList> idsByFingerprint;
 };
 
 struct ImportedGroup {
@@ -104,7 +110,9 @@ public:
     void startImport(GpgME::Protocol proto, const QByteArray &data, const QString &id = QString(), const ImportOptions &options = {});
     void startImport(GpgME::Protocol proto, const std::vector<GpgME::Key> &keys, const QString &id = QString());
     void startImport(GpgME::Protocol proto, const QStringList &keyIds, const QString &id = {});
-    void onImportResult(const GpgME::ImportResult &, QGpgME::Job *job = nullptr);
+    void startImportFromFile(GpgME::Protocol proto, const QString &fileName);
+    void startImportFromFiles(GpgME::Protocol proto, const QStringList &fileNames, const QString &id);
+    void onImportResult(const GpgME::ImportResult &, QObject *job = nullptr);
     void addImportResult(const ImportResultData &result, const ImportJobData &job = ImportJobData{});
 
     void importGroupsFromFile(const QString &filename);
@@ -142,7 +150,7 @@ private:
     std::vector<ImportResultData> results;
     std::vector<ImportedGroup> importedGroups;
     std::shared_ptr<KeyCacheAutoRefreshSuspension> keyCacheAutoRefreshSuspension;
-    QMetaObject::Connection keyListConnection;
+    unsigned int pendingKeyCacheUpdates = 0;
 
     QString progressWindowTitle;
     QString progressLabelText;
@@ -0,0 +1,402 @@
+/* -*- mode: c++; c-basic-offset:4 -*-
+    commands/importfromfilejob.cpp
+
+    This file is part of Kleopatra, the KDE keymanager
+    SPDX-FileCopyrightText: 2024 g10 Code GmbH
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <config-kleopatra.h>
+
+#include "importfromfilejob.h"
+
+#include "kleopatra_debug.h"
+
+#include <utils/certificatefingerprints.h>
+
+#include <Libkleo/AuditLogEntry>
+
+#include <QGpgME/DataProvider>
+
+#include <gpgme++/context.h>
+#include <gpgme++/data.h>
+#include <gpgme++/error.h>
+#include <gpgme++/importresult.h>
+#include <gpgme++/interfaces/dataprovider.h>
+#include <gpgme++/interfaces/progressprovider.h>
+
+#include <QFile>
+#include <QFileInfo>
+#include <QStringList>
+#include <QStringDecoder>
+#include <QThread>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <map>
+#include <optional>
+
+using namespace GpgME;
+using namespace Kleo;
+
+namespace
+{
+// size of the chunks read from files that need to be transcoded
+static const qint64 transcodingChunkSize = 256 * 1024;
+
+/**
+ * Provides the concatenated content of one or more files to GpgME. Files
+ * starting with a byte order mark are decoded chunk by chunk and passed on
+ * UTF-8-encoded. Text files are separated by a line break, so that armored
+ * blocks from different files don't run into each other. Files that cannot
+ * be opened are skipped.
+ */
+class FileDataProvider : public GpgME::DataProvider
+{
+public:
+    FileDataProvider(const QStringList &fileNames, const std::atomic<bool> &canceled)
+        : m_fileNames{fileNames}
+        , m_canceled{canceled}
+    {
+    }
+
+    bool open()
+    {
+        return openNextReadableFile(0);
+    }
+
+    // the total size of the files; this is only a hint for files that are transcoded
+    quint64 sizeHint() const
+    {
+        quint64 size = 0;
+        for (const QString &fileName : m_fileNames) {
+            if (!m_fileErrors.contains(fileName)) {
+                size += QFileInfo{fileName}.size();
+            }
+        }
+        return size;
+    }
+
+    std::map<QString, QString> fileErrors() const
+    {
+        return m_fileErrors;
+    }
+
+    bool isSupported(Operation op) const override
+    {
+        return op == Read || op == Release;
+    }
+
+    ssize_t read(void *buffer, size_t bufSize) override
+    {
+        if (m_canceled) {
+            Error::setSystemError(GPG_ERR_ECANCELED);
+            return -1;
+        }
+        if (bufSize == 0) {
+            return 0;
+        }
+        while (true) {
+            const ssize_t numRead = readFromCurrentFile(static_cast<char *>(buffer), bufSize);
+            if (numRead != 0) {
+                return numRead;
+            }
+            if (m_fileIndex + 1 >= m_fileNames.size()) {
+                return 0;
+            }
+            const bool separate = m_isText && m_lastChar != '\n';
+            if (!openNextReadableFile(m_fileIndex + 1)) {
+                return 0;
+            }
+            if (separate) {
+                static_cast<char *>(buffer)[0] = '\n';
+                return 1;
+            }
+        }
+    }
+
+    ssize_t write(const void *, size_t) override
+    {
+        Error::setSystemError(GPG_ERR_EBADF);
+        return -1;
+    }
+
+    off_t seek(off_t, int) override
+    {
+        Error::setSystemError(GPG_ERR_EBADF);
+        return static_cast<off_t>(-1);
+    }
+
+    void release() override
+    {
+        m_file.close();
+    }
+
+private:
+    bool openNextReadableFile(qsizetype index)
+    {
+        for (; index < m_fileNames.size(); ++index) {
+            if (openFile(index)) {
+                return true;
+            }
+            m_fileErrors[m_fileNames.at(index)] = m_file.errorString();
+        }
+        return false;
+    }
+
+    bool openFile(qsizetype index)
+    {
+        m_file.close();
+        m_fileIndex = index;
+        m_decoder.reset();
+        m_pending.clear();
+        m_pendingOffset = 0;
+        m_lastChar = 0;
+        m_file.setFileName(m_fileNames.at(index));
+        if (!m_file.open(QIODevice::ReadOnly)) {
+            qCWarning(KLEOPATRA_LOG) << __func__ << "Failed to open" << m_file.fileName() << ":" << m_file.errorString();
+            return false;
+        }
+        const QByteArray head = m_file.peek(4);
+        // check for UTF-16- (or UTF-32- or UTF-8-with-BOM-)encoded text file;
+        // binary certificate files don't start with a BOM, so that it's safe
+        // to assume that data starting with a BOM is UTF-encoded text
+        if (const auto encoding = QStringDecoder::encodingForData(head)) {
+            m_decoder.emplace(*encoding);
+            qCDebug(KLEOPATRA_LOG) << __func__ << "Decoding" << m_decoder->name() << "encoded data";
+        }
+        // binary OpenPGP packets and DER start with a byte with the high bit set
+        m_isText = m_decoder || (!head.isEmpty() && !(static_cast<unsigned char>(head[0]) & 0x80));
+        return true;
+    }
+
+    ssize_t readFromCurrentFile(char *buffer, size_t bufSize)
+    {
+        if (!m_decoder) {
+            const qint64 numRead = m_file.read(buffer, bufSize);
+            if (numRead < 0) {
+                Error::setSystemError(GPG_ERR_EIO);
+                return -1;
+            }
+            if (numRead > 0) {
+                m_lastChar = buffer[numRead - 1];
+            }
+            return numRead;
+        }
+        while (m_pendingOffset == m_pending.size()) {
+            const QByteArray chunk = m_file.read(transcodingChunkSize);
+            if (chunk.isEmpty()) {
+                if (m_file.error() != QFileDevice::NoError) {
+                    Error::setSystemError(GPG_ERR_EIO);
+                    return -1;
+                }
+                return 0;
+            }
+            m_pending = QString(m_decoder->decode(chunk)).toUtf8();
+            m_pendingOffset = 0;
+        }
+        const qint64 numRead = std::min<qint64>(bufSize, m_pending.size() - m_pendingOffset);
+        std::memcpy(buffer, m_pending.constData() + m_pendingOffset, numRead);
+        m_pendingOffset += numRead;
+        m_lastChar = buffer[numRead - 1];
+        return numRead;
+    }
+
+private:
+    const QStringList m_fileNames;
+    const std::atomic<bool> &m_canceled;
+    std::map<QString, QString> m_fileErrors;
+    qsizetype m_fileIndex = 0;
+    QFile m_file;
+    bool m_isText = false;
+    char m_lastChar = 0;
+    std::optional<QStringDecoder> m_decoder;
+    QByteArray m_pending;
+    qint64 m_pendingOffset = 0;
+};
+
+/**
+ * Forwards the progress reported by the backend in the worker thread to the
+ * job's thread.
+ */
+class ProgressForwarder : public GpgME::ProgressProvider
+{
+public:
+    explicit ProgressForwarder(ImportFromFileJob *job)
+        : m_job{job}
+    {
+    }
+
+    void showProgress(const char *what, int type, int current, int total) override
+    {
+        Q_UNUSED(what)
+        Q_UNUSED(type)
+        QMetaObject::invokeMethod(
+            m_job,
+            [job = m_job, current, total]() {
+                Q_EMIT job->jobProgress(current, total);
+            },
+            Qt::QueuedConnection);
+    }
+
+private:
+    ImportFromFileJob *const m_job;
+};
+}
+
+class ImportFromFileJob::Private
+{
+    friend class ::Kleo::ImportFromFileJob;
+    ImportFromFileJob *const q;
+
+public:
+    Private(ImportFromFileJob *qq, GpgME::Protocol protocol, const QStringList &fileNames)
+        : q{qq}
+        , m_protocol{protocol}
+        , m_fileNames{fileNames}
+    {
+    }
+
+private:
+    void run();
+    void determineFileNamesByFingerprint();
+
+private:
+    const GpgME::Protocol m_protocol;
+    const QStringList m_fileNames;
+    std::atomic<bool> m_canceled = false;
+    QThread *m_thread = nullptr;
+
+    // written by the worker thread, read after the thread has finished
+    ImportResult m_result;
+    AuditLogEntry m_auditLog;
+    std::map<QString, QString> m_fileErrors;
+    std::map<std::string, QStringList> m_fileNamesByFingerprint;
+};
+
+void ImportFromFileJob::Private::run()
+{
+    const std::unique_ptr<Context> ctx = Context::create(m_protocol);
+    if (!ctx) {
+        m_result = ImportResult{Error::fromCode(GPG_ERR_NOT_SUPPORTED)};
+        return;
+    }
+
+    FileDataProvider provider{m_fileNames, m_canceled};
+    const bool haveReadableFile = provider.open();
+    m_fileErrors = provider.fileErrors();
+    if (!haveReadableFile) {
+        m_result = ImportResult{Error::fromCode(GPG_ERR_EIO)};
+        return;
+    }
+    Data data{&provider};
+    // lets gpg report the progress relative to the total size
+    data.setSizeHint(provider.sizeHint());
+    ProgressForwarder progressForwarder{q};
+    ctx->setProgressProvider(&progressForwarder);
+    m_result = ctx->importKeys(data);
+    ctx->setProgressProvider(nullptr);
+    m_fileErrors = provider.fileErrors();
+    if (m_canceled) {
+        m_result = ImportResult{Error::fromCode(GPG_ERR_CANCELED)};
+    }
+
+    if (m_protocol == GpgME::CMS) {
+        QGpgME::QByteArrayDataProvider auditLogProvider;
+        Data auditLogData{&auditLogProvider};
+        const Error err = ctx->getAuditLog(auditLogData, Context::HtmlAuditLog);
+        m_auditLog = AuditLogEntry{QString::fromUtf8(auditLogProvider.data()), err};
+    }
+
+    if (m_fileNames.size() - m_fileErrors.size() > 1 && !m_result.error() && !m_canceled) {
+        determineFileNamesByFingerprint();
+    }
+}
+
+void ImportFromFileJob::Private::determineFileNamesByFingerprint()
+{
+    // the backend reports the imported certificates for all files together;
+    // to tell which file a certificate came from we read the (small) files
+    // again and compute the fingerprints of the contained certificates
+    for (const QString &fileName : m_fileNames) {
+        QFile file{fileName};
+        if (!file.open(QIODevice::ReadOnly)) {
+            continue;
+        }
+        QByteArray data = file.readAll();
+        if (const auto encoding = QStringDecoder::encodingForData(data)) {
+            QStringDecoder decoder{*encoding};
+            data = QString(decoder.decode(data)).toUtf8();
+        }
+        for (const auto &fingerprint : certificateFingerprints(m_protocol, data)) {
+            auto &fileNames = m_fileNamesByFingerprint[fingerprint];
+            if (!fileNames.contains(fileName)) {
+                fileNames.push_back(fileName);
+            }
+        }
+    }
+}
+
+ImportFromFileJob::ImportFromFileJob(GpgME::Protocol protocol, const QString &fileName, QObject *parent)
+    : ImportFromFileJob{protocol, QStringList{fileName}, parent}
+{
+}
+
+ImportFromFileJob::ImportFromFileJob(GpgME::Protocol protocol, const QStringList &fileNames, QObject *parent)
+    : QObject{parent}
+    , d{new Private{this, protocol, fileNames}}
+{
+    Q_ASSERT(!fileNames.empty());
+}
+
+ImportFromFileJob::~ImportFromFileJob() = default;
+
+GpgME::Protocol ImportFromFileJob::protocol() const
+{
+    return d->m_protocol;
+}
+
+QStringList ImportFromFileJob::fileNames() const
+{
+    return d->m_fileNames;
+}
+
+AuditLogEntry ImportFromFileJob::auditLog() const
+{
+    return d->m_auditLog;
+}
+
+std::map<QString, QString> ImportFromFileJob::fileErrors() const
+{
+    return d->m_fileErrors;
+}
+
+std::map<std::string, QStringList> ImportFromFileJob::fileNamesByFingerprint() const
+{
+    return d->m_fileNamesByFingerprint;
+}
+
+void ImportFromFileJob::startNow()
+{
+    Q_ASSERT(!d->m_thread);
+    d->m_thread = QThread::create([this]() {
+        d->run();
+    });
+    connect(d->m_thread, &QThread::finished, this, [this]() {
+        d->m_thread->deleteLater();
+        d->m_thread = nullptr;
+        Q_EMIT result(d->m_result);
+        deleteLater();
+    });
+    d->m_thread->start();
+}
+
+void ImportFromFileJob::slotCancel()
+{
+    // makes the data provider fail the next read
+    d->m_canceled = true;
+}
+
+#include "moc_importfromfilejob.cpp"
@@ -0,0 +1,99 @@
+/* -*- mode: c++; c-basic-offset:4 -*-
+    commands/importfromfilejob.h
+
+    This file is part of Kleopatra, the KDE keymanager
+    SPDX-FileCopyrightText: 2024 g10 Code GmbH
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QObject>
+#include <QStringList>
+
+#include <gpgme++/global.h>
+
+#include <map>
+#include <memory>
+#include <string>
+
+namespace GpgME
+{
+class ImportResult;
+}
+
+namespace Kleo
+{
+class AuditLogEntry;
+
+/**
+ * Imports the certificates contained in one or more files.
+ *
+ * In contrast to QGpgME::ImportJob, which takes the certificate data as a
+ * byte array, this job streams the data from the file to the backend, so
+ * that the memory usage doesn't depend on the size of the file. Text files
+ * with a byte order mark (e.g. UTF-16-encoded files) are transcoded to UTF-8
+ * on the fly.
+ *
+ * Several files of the same kind (e.g. armored OpenPGP keys or PEM-encoded
+ * certificates) can be imported with a single backend operation by passing
+ * the list of files. The content of the files is concatenated.
+ *
+ * The job deletes itself after emitting result().
+ */
+class ImportFromFileJob : public QObject
+{
+    Q_OBJECT
+public:
+    ImportFromFileJob(GpgME::Protocol protocol, const QString &fileName, QObject *parent = nullptr);
+    ImportFromFileJob(GpgME::Protocol protocol, const QStringList &fileNames, QObject *parent = nullptr);
+    ~ImportFromFileJob() override;
+
+    GpgME::Protocol protocol() const;
+    QStringList fileNames() const;
+
+    /**
+     * Returns the audit log of the import. Only valid after result() has
+     * been emitted.
+     */
+    AuditLogEntry auditLog() const;
+
+    /**
+     * Returns the error messages (by file name) for the files that couldn't
+     * be opened. These files are skipped; the certificates in the other files
+     * are imported nevertheless. Only valid after result() has been emitted.
+     */
+    std::map<QString, QString> fileErrors() const;
+
+    /**
+     * Returns the files (by fingerprint) the imported certificates were read
+     * from if more than one file was imported. Certificates whose fingerprint
+     * couldn't be determined are missing. Only valid after result() has been
+     * emitted.
+     */
+    std::map<std::string, QStringList> fileNamesByFingerprint() const;
+
+    /**
+     * Starts the import in a worker thread. Errors are reported via result().
+     * If none of the files can be opened, then the result has an error.
+     */
+    void startNow();
+
+public Q_SLOTS:
+    void slotCancel();
+
+Q_SIGNALS:
+    /**
+     * Emitted (in the thread of the job) when the backend reports progress.
+     * @p total is 0 if the total is unknown.
+     */
+    void jobProgress(int current, int total);
+    void result(const GpgME::ImportResult &result);
+
+private:
+    class Private;
+    const std::unique_ptr<Private> d;
+};
+
+}
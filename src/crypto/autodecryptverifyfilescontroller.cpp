@@ -19,7 +19,9 @@
 #include <crypto/decryptverifytask.h>
 #include <crypto/gui/decryptverifyfilesdialog.h>
 #include <crypto/gui/decryptverifyoperationwidget.h>
+#include <crypto/signerkeyresolver.h>
 #include <crypto/taskcollection.h>
+#include <crypto/taskrunner.h>
 
 #include "commands/decryptverifyfilescommand.h"
 
@@ -90,8 +92,7 @@ public:
 
     QStringList m_passedFiles, m_filesAfterPreparation;
     std::vector<std::shared_ptr<const DecryptVerifyResult>> m_results;
-    std::vector<std::shared_ptr<Task>> m_runnableTasks, m_completedTasks;
-    std::shared_ptr<Task> m_runningTask;
+    TaskRunner m_runner;
     bool m_errorDetected = false;
     DecryptVerifyOperation m_operation = DecryptVerify;
     QPointer<DecryptVerifyFilesDialog> m_dialog;
@@ -102,22 +103,23 @@ AutoDecryptVerifyFilesController::Private::Private(AutoDecryptVerifyFilesControl
     : q(qq)
 {
     qRegisterMetaType<VerificationResult>();
-}
 
-void AutoDecryptVerifyFilesController::Private::schedule()
-{
-    if (!m_runningTask && !m_runnableTasks.empty()) {
-        const std::shared_ptr<Task> t = m_runnableTasks.back();
-        m_runnableTasks.pop_back();
-        t->start();
-        m_runningTask = t;
-    }
-    if (!m_runningTask) {
-        kleo_assert(m_runnableTasks.empty());
+    // the runner reports the results in the order of the input files
+    QObject::connect(&m_runner, &TaskRunner::result, q, [this](const std::shared_ptr<const Task::Result> &result) {
+        if (const std::shared_ptr<const DecryptVerifyResult> &dvr = std::dynamic_pointer_cast<const DecryptVerifyResult>(result)) {
+            m_results.push_back(dvr);
+        }
+    });
+    QObject::connect(&m_runner, &TaskRunner::finished, q, [this]() {
         for (const std::shared_ptr<const DecryptVerifyResult> &i : std::as_const(m_results)) {
             Q_EMIT q->verificationResult(i->verificationResult());
         }
-    }
+    });
+}
+
+void AutoDecryptVerifyFilesController::Private::schedule()
+{
+    m_runner.start();
 }
 
 QString AutoDecryptVerifyFilesController::Private::getEmbeddedFileName(const QString &fileName) const
@@ -159,14 +161,10 @@ void AutoDecryptVerifyFilesController::Private::exec()
         q->emitDoneOrError();
         return;
     }
-    Q_ASSERT(m_runnableTasks.empty());
-    m_runnableTasks.swap(tasks);
+    m_runner.setTasks(tasks);
 
     std::shared_ptr<TaskCollection> coll(new TaskCollection);
-    for (const std::shared_ptr<Task> &i : std::as_const(m_runnableTasks)) {
-        q->connectTask(i);
-    }
-    coll->setTasks(m_runnableTasks);
+    coll->setTasks(tasks);
     m_dialog = new DecryptVerifyFilesDialog(coll);
     m_dialog->setAttribute(Qt::WA_DeleteOnClose);
     m_dialog->setOutputLocation(heuristicBaseDirectory(m_passedFiles));
@@ -475,6 +473,14 @@ std::vector<std::shared_ptr<Task>> AutoDecryptVerifyFilesController::Private::bu
         }
     }
 
+    // the files are often signed by the same few people
+    const auto signerKeyResolver = std::make_shared<SignerKeyResolver>();
+    for (const auto &task : tasks) {
+        if (const auto dvTask = std::dynamic_pointer_cast<AbstractDecryptVerifyTask>(task)) {
+            dvTask->setSignerKeyResolver(signerKeyResolver);
+        }
+    }
+
     return tasks;
 }
 
@@ -517,14 +523,7 @@ DecryptVerifyOperation AutoDecryptVerifyFilesController::operation() const
 
 void AutoDecryptVerifyFilesController::Private::cancelAllTasks()
 {
-    // we just kill all runnable tasks - this will not result in
-    // signal emissions.
-    m_runnableTasks.clear();
-
-    // a cancel() will result in a call to
-    if (m_runningTask) {
-        m_runningTask->cancel();
-    }
+    m_runner.cancel();
 }
 
 void AutoDecryptVerifyFilesController::cancel()
@@ -541,26 +540,6 @@ void AutoDecryptVerifyFilesController::cancel()
     }
 }
 
-void AutoDecryptVerifyFilesController::doTaskDone(const Task *task, const std::shared_ptr<const Task::Result> &result)
-{
-    Q_ASSERT(task);
-    Q_UNUSED(task)
-
-    // We could just delete the tasks here, but we can't use
-    // Qt::QueuedConnection here (we need sender()) and other slots
-    // might not yet have executed. Therefore, we push completed tasks
-    // into a burial container
-
-    d->m_completedTasks.push_back(d->m_runningTask);
-    d->m_runningTask.reset();
-
-    if (const std::shared_ptr<const DecryptVerifyResult> &dvr = std::dynamic_pointer_cast<const DecryptVerifyResult>(result)) {
-        d->m_results.push_back(dvr);
-    }
-
-    QTimer::singleShot(0, this, SLOT(schedule()));
-}
-
 void AutoDecryptVerifyFilesController::Private::onDialogFinished(int result)
 {
     if (result == QDialog::Rejected) {
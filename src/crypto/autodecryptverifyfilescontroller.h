@@ -41,9 +41,6 @@ public:
 public Q_SLOTS:
     void cancel() override;
 
-private:
-    void doTaskDone(const Task *task, const std::shared_ptr<const Task::Result> &) override;
-
 private:
     class Private;
     const std::unique_ptr<Private> d;
@@ -0,0 +1,268 @@
+/* -*- mode: c++; c-basic-offset:4 -*-
+    crypto/checksumengine_p.cpp
+
+    This file is part of Kleopatra, the KDE keymanager
+    SPDX-FileCopyrightText: 2024 g10 Code GmbH
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "checksumengine_p.h"
+
+#include "kleopatra_debug.h"
+
+#include <Libkleo/ChecksumDefinition>
+
+#include <KLocalizedString>
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QThread>
+
+#include <algorithm>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
+namespace
+{
+// size of the windows of a file that are mapped into memory at once
+static const qint64 mapWindowSize = 64 * 1024 * 1024;
+// size of the buffer used if a file cannot be mapped into memory
+static const qint64 readBufferSize = 1024 * 1024;
+
+static const quint32 indexMagic = 0x4b4c4349; // "KLCI"
+static const quint32 indexVersion = 1;
+
+static const struct {
+    const char *program;
+    QCryptographicHash::Algorithm algorithm;
+} builtinAlgorithms[] = {
+    {"sha1sum", QCryptographicHash::Sha1},
+    {"sha256sum", QCryptographicHash::Sha256},
+    {"sha512sum", QCryptographicHash::Sha512},
+};
+}
+
+std::optional<QCryptographicHash::Algorithm> ChecksumsUtils::builtin_algorithm(const std::shared_ptr<Kleo::ChecksumDefinition> &checksumDefinition)
+{
+    if (!checksumDefinition) {
+        return std::nullopt;
+    }
+    // only take over if both commands are the plain coreutils-compatible tool
+    const QString createProgram = QFileInfo(checksumDefinition->createCommand()).baseName();
+    const QString verifyProgram = QFileInfo(checksumDefinition->verifyCommand()).baseName();
+    for (const auto &builtin : builtinAlgorithms) {
+        const auto program = QLatin1StringView(builtin.program);
+        if (QString::compare(createProgram, program, Qt::CaseInsensitive) == 0 //
+            && QString::compare(verifyProgram, program, Qt::CaseInsensitive) == 0) {
+            return builtin.algorithm;
+        }
+    }
+    return std::nullopt;
+}
+
+QByteArray ChecksumsUtils::hash_file(const QString &fileName,
+                                     QCryptographicHash::Algorithm algorithm,
+                                     const std::function<bool()> &canceled,
+                                     const std::function<void(qint64)> &progress,
+                                     QString *errorString)
+{
+    Q_ASSERT(errorString);
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *errorString = xi18n("Failed to open <filename>%1</filename>: %2", fileName, file.errorString());
+        return {};
+    }
+
+    QCryptographicHash hash(algorithm);
+    const qint64 size = file.size();
+    qint64 offset = 0;
+
+    // try to map the file in large windows; this avoids copying the data
+    while (offset < size) {
+        if (canceled && canceled()) {
+            *errorString = i18n("Operation canceled.");
+            return {};
+        }
+        const qint64 length = std::min(mapWindowSize, size - offset);
+        uchar *const data = file.map(offset, length);
+        if (!data) {
+            break;
+        }
+        hash.addData(QByteArrayView{reinterpret_cast<const char *>(data), length});
+        file.unmap(data);
+        offset += length;
+        if (progress) {
+            progress(length);
+        }
+    }
+
+    if (offset < size || size == 0) {
+        // mapping is not possible (e.g. for some special or network files) or
+        // the size is unknown; read the (remaining) data with a large buffer
+        if (!file.seek(offset)) {
+            *errorString = xi18n("Failed to read <filename>%1</filename>: %2", fileName, file.errorString());
+            return {};
+        }
+        QByteArray buffer(readBufferSize, Qt::Uninitialized);
+        while (true) {
+            if (canceled && canceled()) {
+                *errorString = i18n("Operation canceled.");
+                return {};
+            }
+            const qint64 n = file.read(buffer.data(), buffer.size());
+            if (n < 0) {
+                *errorString = xi18n("Failed to read <filename>%1</filename>: %2", fileName, file.errorString());
+                return {};
+            }
+            if (n == 0) {
+                break;
+            }
+            hash.addData(QByteArrayView{buffer.constData(), n});
+            if (progress) {
+                progress(n);
+            }
+        }
+    }
+
+    return hash.result().toHex();
+}
+
+QByteArray ChecksumsUtils::format_sum_line(const QString &fileName, const QByteArray &checksum)
+{
+#ifdef Q_OS_WIN
+    const QByteArray encodedName = fileName.toUtf8();
+    // binary mode marker
+    static const char modeMarker = '*';
+#else
+    const QByteArray encodedName = QFile::encodeName(fileName);
+    // text mode marker (no difference to binary mode on POSIX systems)
+    static const char modeMarker = ' ';
+#endif
+
+    QByteArray line;
+    line.reserve(checksum.size() + encodedName.size() + 4);
+    const bool needsEscaping = encodedName.contains('\\') || encodedName.contains('\n');
+    if (needsEscaping) {
+        line += '\\';
+    }
+    line += checksum;
+    line += ' ';
+    line += modeMarker;
+    if (needsEscaping) {
+        for (const char ch : encodedName) {
+            switch (ch) {
+            case '\\':
+                line += "\\\\";
+                break;
+            case '\n':
+                line += "\\n";
+                break;
+            default:
+                line += ch;
+            }
+        }
+    } else {
+        line += encodedName;
+    }
+    line += '\n';
+    return line;
+}
+
+int ChecksumsUtils::hashing_thread_count()
+{
+    return std::max(1, QThread::idealThreadCount());
+}
+
+ChecksumsUtils::FileStamp ChecksumsUtils::file_stamp(const QString &fileName)
+{
+    FileStamp stamp;
+#ifdef Q_OS_UNIX
+    struct stat st;
+    if (::stat(QFile::encodeName(fileName).constData(), &st) != 0) {
+        return stamp;
+    }
+    stamp.size = st.st_size;
+#if defined(Q_OS_DARWIN)
+    stamp.mtime = qint64(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+    stamp.mtime = qint64(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+    stamp.inode = st.st_ino;
+#else
+    const QFileInfo fi(fileName);
+    if (!fi.exists()) {
+        return stamp;
+    }
+    stamp.size = fi.size();
+    stamp.mtime = fi.lastModified().toMSecsSinceEpoch() * 1000000;
+#endif
+    return stamp;
+}
+
+QString ChecksumsUtils::index_file_name(const QString &sumFile)
+{
+    return QLatin1Char('.') + sumFile + QLatin1StringView(".kleo-index");
+}
+
+bool ChecksumsUtils::is_index_file(const QString &fileName)
+{
+    return fileName.startsWith(QLatin1Char('.')) && fileName.endsWith(QLatin1StringView(".kleo-index"));
+}
+
+ChecksumsUtils::ChecksumIndex ChecksumsUtils::read_index(const QString &fileName, QCryptographicHash::Algorithm algorithm)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return {};
+    }
+    QDataStream stream(&file);
+    quint32 magic = 0;
+    quint32 version = 0;
+    qint32 algo = -1;
+    stream >> magic >> version >> algo;
+    if (magic != indexMagic || version != indexVersion || algo != static_cast<qint32>(algorithm)) {
+        qCDebug(KLEOPATRA_LOG) << __func__ << "Ignoring incompatible index" << fileName;
+        return {};
+    }
+    stream.setVersion(QDataStream::Qt_6_0);
+
+    quint32 count = 0;
+    stream >> count;
+    ChecksumIndex index;
+    index.reserve(count);
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QString name;
+        IndexEntry entry;
+        stream >> name >> entry.stamp.size >> entry.stamp.mtime >> entry.stamp.inode >> entry.checksum;
+        index.insert(name, entry);
+    }
+    if (stream.status() != QDataStream::Ok) {
+        qCDebug(KLEOPATRA_LOG) << __func__ << "Ignoring corrupt index" << fileName;
+        return {};
+    }
+    return index;
+}
+
+bool ChecksumsUtils::write_index(const QString &fileName, QCryptographicHash::Algorithm algorithm, const ChecksumIndex &index)
+{
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCDebug(KLEOPATRA_LOG) << __func__ << "Failed to write index" << fileName << ":" << file.errorString();
+        return false;
+    }
+    QDataStream stream(&file);
+    stream << indexMagic << indexVersion << static_cast<qint32>(algorithm);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream << static_cast<quint32>(index.size());
+    for (auto it = index.cbegin(), end = index.cend(); it != end; ++it) {
+        stream << it.key() << it->stamp.size << it->stamp.mtime << it->stamp.inode << it->checksum;
+    }
+    return stream.status() == QDataStream::Ok && file.commit();
+}
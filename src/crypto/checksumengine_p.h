@@ -0,0 +1,115 @@
+/* -*- mode: c++; c-basic-offset:4 -*-
+    crypto/checksumengine_p.h
+
+    This file is part of Kleopatra, the KDE keymanager
+    SPDX-FileCopyrightText: 2024 g10 Code GmbH
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QHash>
+#include <QString>
+
+#include <functional>
+#include <memory>
+#include <optional>
+
+namespace Kleo
+{
+class ChecksumDefinition;
+}
+
+namespace ChecksumsUtils
+{
+
+/**
+ * Returns the hash algorithm to use for computing checksums of type
+ * @p checksumDefinition in-process, or std::nullopt if the checksums have
+ * to be created or verified with the external program of the definition.
+ */
+std::optional<QCryptographicHash::Algorithm> builtin_algorithm(const std::shared_ptr<Kleo::ChecksumDefinition> &checksumDefinition);
+
+/**
+ * Computes the checksum of the file @p fileName and returns it hex-encoded.
+ *
+ * The file is mapped into memory in large windows if possible and read with
+ * a large buffer otherwise. @p canceled is polled between the windows;
+ * @p progress (if set) is called with the number of bytes hashed since the
+ * last call. Returns an empty byte array and sets @p errorString on failure
+ * or cancellation.
+ */
+QByteArray hash_file(const QString &fileName,
+                     QCryptographicHash::Algorithm algorithm,
+                     const std::function<bool()> &canceled,
+                     const std::function<void(qint64)> &progress,
+                     QString *errorString);
+
+/**
+ * Returns a line for @p fileName and the hex-encoded @p checksum in the
+ * format written (and read) by the sha256sum family of tools, including
+ * the escaping of backslashes and newlines in file names.
+ */
+QByteArray format_sum_line(const QString &fileName, const QByteArray &checksum);
+
+/**
+ * Returns the number of threads to use for hashing files in parallel.
+ */
+int hashing_thread_count();
+
+/**
+ * The properties of a file that are used to decide whether a checksum
+ * computed earlier is still valid for the file.
+ */
+struct FileStamp {
+    qint64 size = -1;
+    qint64 mtime = 0;
+    quint64 inode = 0;
+
+    bool isValid() const
+    {
+        return size >= 0;
+    }
+    bool operator==(const FileStamp &other) const = default;
+};
+
+FileStamp file_stamp(const QString &fileName);
+
+struct IndexEntry {
+    FileStamp stamp;
+    QByteArray checksum;
+};
+
+/**
+ * The checksums of the files of a directory (keyed by file name) together
+ * with the stamps the files had when the checksums were computed. The index
+ * is stored next to the sum file and allows reusing the checksums of
+ * unchanged files when the sum file is recreated.
+ */
+using ChecksumIndex = QHash<QString, IndexEntry>;
+
+/**
+ * Returns the file name of the index belonging to the sum file @p sumFile.
+ */
+QString index_file_name(const QString &sumFile);
+
+/**
+ * Returns true if @p fileName is the file name of an index.
+ */
+bool is_index_file(const QString &fileName);
+
+/**
+ * Reads the index stored in @p fileName. Returns an empty index if the file
+ * does not exist, cannot be read, or was written for a different algorithm.
+ */
+ChecksumIndex read_index(const QString &fileName, QCryptographicHash::Algorithm algorithm);
+
+/**
+ * Writes @p index for checksums computed with @p algorithm to @p fileName.
+ */
+bool write_index(const QString &fileName, QCryptographicHash::Algorithm algorithm, const ChecksumIndex &index);
+
+} // namespace ChecksumsUtils
@@ -9,6 +9,7 @@
 
 #include <config-kleopatra.h>
 
+#include "checksumengine_p.h"
 #include "checksumsutils_p.h"
 #include "createchecksumscontroller.h"
 
@@ -37,10 +38,13 @@
 #include <QPointer>
 #include <QProcess>
 #include <QProgressDialog>
+#include <QSaveFile>
 #include <QThread>
+#include <QThreadPool>
 
 #include <gpg-error.h>
 
+#include <atomic>
 #include <deque>
 #include <functional>
 #include <limits>
@@ -207,6 +211,7 @@ private:
     QStringList files;
     QStringList errors, created;
     bool allowAddition;
+    bool incremental;
     volatile bool canceled;
 };
 
@@ -224,6 +229,7 @@ CreateChecksumsController::Private::Private(CreateChecksumsController *qq)
     , errors()
     , created()
     , allowAddition(false)
+    , incremental(false)
     , canceled(false)
 {
     connect(this, SIGNAL(progress(int, int, QString)), q, SLOT(slotProgress(int, int, QString)));
@@ -280,6 +286,19 @@ bool CreateChecksumsController::allowAddition() const
     return d->allowAddition;
 }
 
+void CreateChecksumsController::setIncremental(bool incremental)
+{
+    kleo_assert(!d->isRunning());
+    const QMutexLocker locker(&d->mutex);
+    d->incremental = incremental;
+}
+
+bool CreateChecksumsController::incremental() const
+{
+    const QMutexLocker locker(&d->mutex);
+    return d->incremental;
+}
+
 void CreateChecksumsController::start()
 {
     {
@@ -324,7 +343,7 @@ struct Dir {
 
 static QStringList remove_checksum_files(QStringList l, const std::vector<QRegularExpression> &rxs)
 {
-    QStringList::iterator end = l.end();
+    QStringList::iterator end = std::remove_if(l.begin(), l.end(), &ChecksumsUtils::is_index_file);
     for (const auto &rx : rxs) {
         end = std::remove_if(l.begin(), end, [rx](const QString &str) {
             return rx.match(str).hasMatch();
@@ -498,6 +517,128 @@ static QString process(const Dir &dir, bool *fatal)
     return xi18n("Failed to overwrite <filename>%1</filename>.", dir.sumFile);
 }
 
+static QString write_sum_file(const Dir &dir, const std::vector<QByteArray> &checksums)
+{
+    Q_ASSERT(static_cast<qsizetype>(checksums.size()) == dir.inputFiles.size());
+    QSaveFile out(dir.dir.absoluteFilePath(dir.sumFile));
+    if (!out.open(QIODevice::WriteOnly)) {
+        return xi18n("Failed to overwrite <filename>%1</filename>.", dir.sumFile);
+    }
+    for (qsizetype i = 0; i < dir.inputFiles.size(); ++i) {
+        out.write(ChecksumsUtils::format_sum_line(dir.inputFiles[i], checksums[i]));
+    }
+    if (!out.commit()) {
+        return xi18n("Failed to overwrite <filename>%1</filename>.", dir.sumFile);
+    }
+    return QString();
+}
+
+// Creates the checksum files for all @p dirs in-process. The files of all
+// directories are hashed in parallel; each checksum file is written as soon
+// as all files of its directory have been hashed. In incremental mode, the
+// checksums of files which didn't change since the last run are taken from
+// the index stored next to the checksum file.
+static void process_builtin(const std::vector<Dir> &dirs,
+                            bool incremental,
+                            const std::function<bool()> &canceled,
+                            const std::function<void(qint64)> &progress,
+                            QStringList &errors,
+                            QStringList &created)
+{
+    struct DirState {
+        QCryptographicHash::Algorithm algorithm;
+        ChecksumsUtils::ChecksumIndex oldIndex;
+        std::vector<ChecksumsUtils::FileStamp> stamps;
+        std::vector<QByteArray> checksums;
+        QStringList errors;
+        std::atomic<qsizetype> pending;
+    };
+
+    QMutex resultMutex;
+    std::vector<std::unique_ptr<DirState>> states;
+    states.reserve(dirs.size());
+
+    const auto finishDir = [&](const Dir &dir, DirState *state) {
+        if (canceled()) {
+            return;
+        }
+        const QString error = state->errors.empty() ? write_sum_file(dir, state->checksums) : state->errors.join(QLatin1Char('\n'));
+        if (incremental && error.isEmpty()) {
+            ChecksumsUtils::ChecksumIndex index;
+            index.reserve(dir.inputFiles.size());
+            for (qsizetype i = 0; i < dir.inputFiles.size(); ++i) {
+                if (state->stamps[i].isValid()) {
+                    index.insert(dir.inputFiles[i], {state->stamps[i], state->checksums[i]});
+                }
+            }
+            ChecksumsUtils::write_index(dir.dir.absoluteFilePath(ChecksumsUtils::index_file_name(dir.sumFile)), state->algorithm, index);
+        }
+        const QMutexLocker locker(&resultMutex);
+        if (!error.isEmpty()) {
+            errors.push_back(error);
+        } else {
+            created.push_back(dir.dir.absoluteFilePath(dir.sumFile));
+        }
+        // the checksums are no longer needed
+        state->oldIndex = {};
+        state->stamps = {};
+        state->checksums = {};
+    };
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(ChecksumsUtils::hashing_thread_count());
+
+    for (const Dir &dir : dirs) {
+        states.push_back(std::make_unique<DirState>());
+        DirState *const state = states.back().get();
+        state->algorithm = *ChecksumsUtils::builtin_algorithm(dir.checksumDefinition);
+        if (incremental) {
+            state->oldIndex = ChecksumsUtils::read_index(dir.dir.absoluteFilePath(ChecksumsUtils::index_file_name(dir.sumFile)), state->algorithm);
+            state->stamps.resize(dir.inputFiles.size());
+        }
+        state->checksums.resize(dir.inputFiles.size());
+        state->pending = dir.inputFiles.size();
+        if (dir.inputFiles.empty()) {
+            finishDir(dir, state);
+            continue;
+        }
+        for (qsizetype i = 0; i < dir.inputFiles.size(); ++i) {
+            if (canceled()) {
+                break;
+            }
+            pool.start([&, dirPtr = &dir, state, i]() {
+                const Dir &dir = *dirPtr;
+                QString error;
+                if (!canceled()) {
+                    const QString fileName = dir.dir.absoluteFilePath(dir.inputFiles[i]);
+                    if (incremental) {
+                        // take the stamp before hashing, so that a file which changes
+                        // while it is hashed is hashed again next time
+                        state->stamps[i] = ChecksumsUtils::file_stamp(fileName);
+                        const auto it = state->oldIndex.constFind(dir.inputFiles[i]);
+                        if (state->stamps[i].isValid() && it != state->oldIndex.cend() && it->stamp == state->stamps[i]) {
+                            state->checksums[i] = it->checksum;
+                            progress(state->stamps[i].size);
+                        }
+                    }
+                    if (state->checksums[i].isEmpty()) {
+                        state->checksums[i] = ChecksumsUtils::hash_file(fileName, state->algorithm, canceled, progress, &error);
+                    }
+                    if (state->checksums[i].isEmpty()) {
+                        const QMutexLocker locker(&resultMutex);
+                        state->errors.push_back(error);
+                    }
+                }
+                if (--state->pending == 0) {
+                    finishDir(dir, state);
+                }
+            });
+        }
+    }
+
+    pool.waitForDone();
+}
+
 namespace
 {
 static QDebug operator<<(QDebug s, const Dir &dir)
@@ -514,6 +655,7 @@ void CreateChecksumsController::Private::run()
     const std::vector<std::shared_ptr<ChecksumDefinition>> checksumDefinitions = this->checksumDefinitions;
     const std::shared_ptr<ChecksumDefinition> checksumDefinition = this->checksumDefinition;
     const bool allowAddition = this->allowAddition;
+    const bool incremental = this->incremental;
 
     locker.unlock();
 
@@ -560,8 +702,44 @@ void CreateChecksumsController::Private::run()
             // re-scale 'total' to fit into ints (wish QProgressDialog would use quint64...)
             const quint64 factor = total / std::numeric_limits<int>::max() + 1;
 
-            quint64 done = 0;
-            for (const Dir &dir : dirs) {
+            // Step 2a: hash all files we can handle ourselves in parallel:
+
+            std::vector<Dir> builtinDirs;
+            std::vector<Dir> externalDirs;
+            std::partition_copy(dirs.cbegin(), dirs.cend(), std::back_inserter(builtinDirs), std::back_inserter(externalDirs), [](const Dir &dir) {
+                return ChecksumsUtils::builtin_algorithm(dir.checksumDefinition).has_value();
+            });
+
+            std::atomic<quint64> hashed = 0;
+            if (!builtinDirs.empty()) {
+                const QString calculating = i18n("Calculating checksums...");
+                Q_EMIT progress(0, total / factor, calculating);
+                // don't flood the GUI thread with progress updates for every file
+                const quint64 granularity = std::max<quint64>(total / 1000, 1);
+                const auto progressCb = [&](qint64 n) {
+                    const quint64 before = hashed.fetch_add(n);
+                    if ((before + n) / granularity != before / granularity) {
+                        Q_EMIT progress((before + n) / factor, total / factor, calculating);
+                    }
+                };
+                process_builtin(
+                    builtinDirs,
+                    incremental,
+                    [this]() {
+                        return canceled;
+                    },
+                    progressCb,
+                    errors,
+                    created);
+            }
+
+            // Step 2b: fall back to the external programs for the rest:
+
+            quint64 done = kdtools::accumulate_transform(builtinDirs.cbegin(), builtinDirs.cend(), std::mem_fn(&Dir::totalSize), Q_UINT64_C(0));
+            for (const Dir &dir : externalDirs) {
+                if (canceled) {
+                    break;
+                }
                 Q_EMIT progress(done / factor, total / factor, i18n("Checksumming (%2) in %1", dir.checksumDefinition->label(), dir.dir.path()));
                 bool fatal = false;
                 const QString error = process(dir, &fatal);
@@ -32,6 +32,16 @@ public:
     void setAllowAddition(bool allow);
     bool allowAddition() const;
 
+    /**
+     * If @p incremental is true, then an index of the checksummed files is
+     * kept next to each checksum file and the checksums of files whose size,
+     * modification time and inode didn't change are taken from this index
+     * instead of hashing the files again. This is only supported for the
+     * checksum types which are computed in-process.
+     */
+    void setIncremental(bool incremental);
+    bool incremental() const;
+
     void setFiles(const QStringList &files);
 
     void start();
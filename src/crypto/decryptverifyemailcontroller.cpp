@@ -16,6 +16,7 @@
 
 #include <crypto/decryptverifytask.h>
 #include <crypto/gui/newresultpage.h>
+#include <crypto/signerkeyresolver.h>
 #include <crypto/taskcollection.h>
 
 #include <Libkleo/GnuPG>
@@ -281,6 +282,8 @@ std::vector<std::shared_ptr<AbstractDecryptVerifyTask>> DecryptVerifyEMailContro
     }
 
     std::vector<std::shared_ptr<AbstractDecryptVerifyTask>> tasks;
+    // the messages are often signed by the same few people
+    const auto signerKeyResolver = std::make_shared<SignerKeyResolver>();
 
     for (unsigned int i = 0; i < numInputs; ++i) {
         std::shared_ptr<AbstractDecryptVerifyTask> task;
@@ -330,6 +333,7 @@ std::vector<std::shared_ptr<AbstractDecryptVerifyTask>> DecryptVerifyEMailContro
         }
 
         Q_ASSERT(task);
+        task->setSignerKeyResolver(signerKeyResolver);
         tasks.push_back(task);
     }
 
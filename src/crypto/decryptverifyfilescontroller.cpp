@@ -14,7 +14,9 @@
 #include <crypto/decryptverifytask.h>
 #include <crypto/gui/decryptverifyfileswizard.h>
 #include <crypto/gui/decryptverifyoperationwidget.h>
+#include <crypto/signerkeyresolver.h>
 #include <crypto/taskcollection.h>
+#include <crypto/taskrunner.h>
 
 #include <Libkleo/GnuPG>
 #include <utils/archivedefinition.h>
@@ -70,8 +72,7 @@ public:
     QStringList m_passedFiles, m_filesAfterPreparation;
     QPointer<DecryptVerifyFilesWizard> m_wizard;
     std::vector<std::shared_ptr<const DecryptVerifyResult>> m_results;
-    std::vector<std::shared_ptr<Task>> m_runnableTasks, m_completedTasks;
-    std::shared_ptr<Task> m_runningTask;
+    TaskRunner m_runner;
     bool m_errorDetected;
     DecryptVerifyOperation m_operation;
 };
@@ -148,6 +149,19 @@ DecryptVerifyFilesController::Private::Private(DecryptVerifyFilesController *qq)
     , m_operation(DecryptVerify)
 {
     qRegisterMetaType<VerificationResult>();
+
+    // the runner reports the results in the order of the input files
+    QObject::connect(&m_runner, &TaskRunner::result, q, [this](const std::shared_ptr<const Task::Result> &result) {
+        if (const std::shared_ptr<const DecryptVerifyResult> &dvr = std::dynamic_pointer_cast<const DecryptVerifyResult>(result)) {
+            m_results.push_back(dvr);
+        }
+    });
+    QObject::connect(&m_runner, &TaskRunner::finished, q, [this]() {
+        for (const auto &i : m_results) {
+            Q_EMIT q->verificationResult(i->verificationResult());
+        }
+        q->emitDoneOrError();
+    });
 }
 
 void DecryptVerifyFilesController::Private::slotWizardOperationPrepared()
@@ -157,14 +171,10 @@ void DecryptVerifyFilesController::Private::slotWizardOperationPrepared()
     if (tasks.empty()) {
         reportError(makeGnuPGError(GPG_ERR_ASS_NO_INPUT), i18n("No usable inputs found"));
     }
-    kleo_assert(m_runnableTasks.empty());
-    m_runnableTasks.swap(tasks);
+    m_runner.setTasks(tasks);
 
     std::shared_ptr<TaskCollection> coll(new TaskCollection);
-    for (const auto &i : m_runnableTasks) {
-        q->connectTask(i);
-    }
-    coll->setTasks(m_runnableTasks);
+    coll->setTasks(tasks);
     m_wizard->setTaskCollection(coll);
 
     QTimer::singleShot(0, q, SLOT(schedule()));
@@ -177,41 +187,9 @@ void DecryptVerifyFilesController::Private::slotWizardCanceled()
     q->emitDoneOrError();
 }
 
-void DecryptVerifyFilesController::doTaskDone(const Task *task, const std::shared_ptr<const Task::Result> &result)
-{
-    Q_ASSERT(task);
-    Q_UNUSED(task)
-
-    // We could just delete the tasks here, but we can't use
-    // Qt::QueuedConnection here (we need sender()) and other slots
-    // might not yet have executed. Therefore, we push completed tasks
-    // into a burial container
-
-    d->m_completedTasks.push_back(d->m_runningTask);
-    d->m_runningTask.reset();
-
-    if (const std::shared_ptr<const DecryptVerifyResult> &dvr = std::dynamic_pointer_cast<const DecryptVerifyResult>(result)) {
-        d->m_results.push_back(dvr);
-    }
-
-    QTimer::singleShot(0, this, SLOT(schedule()));
-}
-
 void DecryptVerifyFilesController::Private::schedule()
 {
-    if (!m_runningTask && !m_runnableTasks.empty()) {
-        const std::shared_ptr<Task> t = m_runnableTasks.back();
-        m_runnableTasks.pop_back();
-        t->start();
-        m_runningTask = t;
-    }
-    if (!m_runningTask) {
-        kleo_assert(m_runnableTasks.empty());
-        for (const auto &i : m_results) {
-            Q_EMIT q->verificationResult(i->verificationResult());
-        }
-        q->emitDoneOrError();
-    }
+    m_runner.start();
 }
 
 void DecryptVerifyFilesController::Private::ensureWizardCreated()
@@ -368,12 +346,16 @@ std::vector<std::shared_ptr<Task>> DecryptVerifyFilesController::Private::buildT
     kleo_assert(!useOutDir || outDir.exists());
 
     std::vector<std::shared_ptr<Task>> tasks;
+    // the files are often signed by the same few people
+    const auto signerKeyResolver = std::make_shared<SignerKeyResolver>();
     for (int i = 0, end = fileNames.size(); i != end; ++i)
         try {
             const QDir fileDir = QFileInfo(fileNames[i]).absoluteDir();
             kleo_assert(fileDir.exists());
-            tasks.push_back(
-                taskFromOperationWidget(m_wizard->operationWidget(static_cast<unsigned int>(i)), fileNames[i], useOutDir ? outDir : fileDir, overwritePolicy));
+            const auto task =
+                taskFromOperationWidget(m_wizard->operationWidget(static_cast<unsigned int>(i)), fileNames[i], useOutDir ? outDir : fileDir, overwritePolicy);
+            task->setSignerKeyResolver(signerKeyResolver);
+            tasks.push_back(task);
         } catch (const GpgME::Exception &e) {
             tasks.push_back(Task::makeErrorTask(e.error(), QString::fromLocal8Bit(e.what()), fileNames[i]));
         }
@@ -427,14 +409,7 @@ DecryptVerifyOperation DecryptVerifyFilesController::operation() const
 
 void DecryptVerifyFilesController::Private::cancelAllTasks()
 {
-    // we just kill all runnable tasks - this will not result in
-    // signal emissions.
-    m_runnableTasks.clear();
-
-    // a cancel() will result in a call to
-    if (m_runningTask) {
-        m_runningTask->cancel();
-    }
+    m_runner.cancel();
 }
 
 void DecryptVerifyFilesController::cancel()
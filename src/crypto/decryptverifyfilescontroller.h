@@ -50,9 +50,6 @@ protected:
 Q_SIGNALS:
     void verificationResult(const GpgME::VerificationResult &);
 
-private:
-    void doTaskDone(const Task *task, const std::shared_ptr<const Task::Result> &) override;
-
 private:
     class Private;
     std::shared_ptr<Private> d;
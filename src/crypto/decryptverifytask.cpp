@@ -11,6 +11,8 @@
 
 #include "decryptverifytask.h"
 
+#include "signerkeyresolver.h"
+
 #include <QGpgME/DecryptJob>
 #include <QGpgME/DecryptVerifyArchiveJob>
 #include <QGpgME/DecryptVerifyJob>
@@ -29,6 +31,7 @@
 #include <Libkleo/Stl_Util>
 
 #include <Libkleo/GnuPG>
+#include <utils/compressedauditlogentry.h>
 #include <utils/detail_p.h>
 #include <utils/input.h>
 #include <utils/kleo_assert.h>
@@ -266,14 +269,13 @@ static QString formatDate(const QDateTime &dt)
 {
     return QLocale().toString(dt);
 }
-static QString formatSigningInformation(const Signature &sig)
+static QString formatSigningInformation(const Signature &sig, const Key &key)
 {
     if (sig.isNull()) {
         return QString();
     }
     const QDateTime dt = sig.creationTime() != 0 ? QDateTime::fromSecsSinceEpoch(quint32(sig.creationTime())) : QDateTime();
     QString text;
-    Key key = sig.key();
     if (dt.isValid()) {
         text = i18nc("1 is a date", "Signature created on %1", formatDate(dt)) + QStringLiteral("<br>");
     }
@@ -338,18 +340,6 @@ static UserID findUserIDByMailbox(const Key &key, const Mailbox &mbox)
     return UserID();
 }
 
-static void updateKeys(const VerificationResult &result)
-{
-    // This little hack works around the problem that GnuPG / GpgME does not
-    // provide Key information in a verification result. The Key object is
-    // a dummy just holding the KeyID. This hack ensures that all available
-    // keys are fetched from the backend and are populated
-    for (const auto &sig : result.signatures()) {
-        // Update key information
-        sig.key(true, true);
-    }
-}
-
 static QString ensureUniqueDirectory(const QString &path)
 {
     // make sure that we don't use an existing directory
@@ -381,6 +371,7 @@ public:
     {
     }
     const Mailbox informativeSender;
+    // the certificates of the signers in the order of the signatures; null for unknown signers
     const std::vector<Key> signers;
     bool hasInformativeSender() const
     {
@@ -461,10 +452,10 @@ static QString formatVerificationResultOverview(const VerificationResult &res, c
     // Good signature:
     QString text;
     if (sigs.size() == 1) {
-        text = i18n("<b>Valid signature by %1</b>", renderKeyEMailOnlyNameAsFallback(sigs[0].key()));
+        text = i18n("<b>Valid signature by %1</b>", renderKeyEMailOnlyNameAsFallback(info.signers[0]));
         if (info.conflicts())
             text += i18n("<br/><b>Warning:</b> The sender's mail address is not stored in the %1 used for signing.",
-                         renderKeyLink(QLatin1StringView(sigs[0].key().primaryFingerprint()), i18n("certificate")));
+                         renderKeyLink(QLatin1StringView(info.signers[0].primaryFingerprint()), i18n("certificate")));
     } else {
         text = i18np("<b>Valid signature.</b>", "<b>%1 valid signatures.</b>", sigs.size());
         if (info.conflicts()) {
@@ -491,14 +482,13 @@ static QString formatDecryptionResultOverview(const DecryptionResult &result, co
     return i18n("<b>Decryption succeeded.</b>");
 }
 
-static QString formatSignature(const Signature &sig, const DecryptVerifyResult::SenderInfo &info)
+static QString formatSignature(const Signature &sig, const Key &key, const DecryptVerifyResult::SenderInfo &info)
 {
     if (sig.isNull()) {
         return QString();
     }
 
-    const QString text = formatSigningInformation(sig) + QLatin1StringView("<br/>");
-    const Key key = sig.key();
+    const QString text = formatSigningInformation(sig, key) + QLatin1StringView("<br/>");
 
     // Green
     if (sig.summary() & Signature::Valid) {
@@ -555,8 +545,8 @@ static QString formatVerificationResultDetails(const VerificationResult &res, co
 
     const std::vector<Signature> sigs = res.signatures();
     QString details;
-    for (const Signature &sig : sigs) {
-        details += formatSignature(sig, info) + QLatin1Char('\n');
+    for (std::size_t i = 0; i < sigs.size(); ++i) {
+        details += formatSignature(sigs[i], info.signers[i], info) + QLatin1Char('\n');
     }
     details = details.trimmed();
     details.replace(QLatin1Char('\n'), QStringLiteral("<br/><br/>"));
@@ -686,6 +676,7 @@ class DecryptVerifyResult::Private
 public:
     Private(DecryptVerifyOperation type,
             const VerificationResult &vr,
+            const std::vector<Key> &signers,
             const DecryptionResult &dr,
             const QByteArray &stuff,
             const QString &fileName,
@@ -700,6 +691,7 @@ public:
         : q(qq)
         , m_type(type)
         , m_verificationResult(vr)
+        , m_signers(signers)
         , m_decryptionResult(dr)
         , m_stuff(stuff)
         , m_fileName(fileName)
@@ -734,6 +726,7 @@ public:
     }
     DecryptVerifyOperation m_type;
     VerificationResult m_verificationResult;
+    std::vector<Key> m_signers;
     DecryptionResult m_decryptionResult;
     QByteArray m_stuff;
     QString m_fileName;
@@ -741,14 +734,14 @@ public:
     QString m_errorString;
     QString m_inputLabel;
     QString m_outputLabel;
-    const AuditLogEntry m_auditLog;
+    const CompressedAuditLogEntry m_auditLog;
     QPointer<Task> m_parentTask;
     const Mailbox m_informativeSender;
 };
 
 DecryptVerifyResult::SenderInfo DecryptVerifyResult::Private::makeSenderInfo() const
 {
-    return SenderInfo(m_informativeSender, KeyCache::instance()->findSigners(m_verificationResult));
+    return SenderInfo(m_informativeSender, m_signers);
 }
 
 std::shared_ptr<DecryptVerifyResult>
@@ -756,6 +749,7 @@ AbstractDecryptVerifyTask::fromDecryptResult(const DecryptionResult &dr, const Q
 {
     return std::shared_ptr<DecryptVerifyResult>(new DecryptVerifyResult(Decrypt, //
                                                                         VerificationResult(),
+                                                                        {},
                                                                         dr,
                                                                         plaintext,
                                                                         {},
@@ -772,6 +766,7 @@ std::shared_ptr<DecryptVerifyResult> AbstractDecryptVerifyTask::fromDecryptResul
 {
     return std::shared_ptr<DecryptVerifyResult>(new DecryptVerifyResult(Decrypt, //
                                                                         VerificationResult(),
+                                                                        {},
                                                                         DecryptionResult(err),
                                                                         QByteArray(),
                                                                         {},
@@ -793,6 +788,7 @@ std::shared_ptr<DecryptVerifyResult> AbstractDecryptVerifyTask::fromDecryptVerif
     const auto err = dr.error().code() ? dr.error() : vr.error();
     return std::shared_ptr<DecryptVerifyResult>(new DecryptVerifyResult(DecryptVerify, //
                                                                         vr,
+                                                                        d->signerKeys(vr, protocol()),
                                                                         dr,
                                                                         plaintext,
                                                                         fileName,
@@ -810,6 +806,7 @@ AbstractDecryptVerifyTask::fromDecryptVerifyResult(const GpgME::Error &err, cons
 {
     return std::shared_ptr<DecryptVerifyResult>(new DecryptVerifyResult(DecryptVerify, //
                                                                         VerificationResult(),
+                                                                        {},
                                                                         DecryptionResult(err),
                                                                         QByteArray(),
                                                                         {},
@@ -827,6 +824,7 @@ AbstractDecryptVerifyTask::fromVerifyOpaqueResult(const VerificationResult &vr,
 {
     return std::shared_ptr<DecryptVerifyResult>(new DecryptVerifyResult(Verify, //
                                                                         vr,
+                                                                        d->signerKeys(vr, protocol()),
                                                                         DecryptionResult(),
                                                                         plaintext,
                                                                         {},
@@ -843,6 +841,7 @@ AbstractDecryptVerifyTask::fromVerifyOpaqueResult(const GpgME::Error &err, const
 {
     return std::shared_ptr<DecryptVerifyResult>(new DecryptVerifyResult(Verify, //
                                                                         VerificationResult(err),
+                                                                        {},
                                                                         DecryptionResult(),
                                                                         QByteArray(),
                                                                         {},
@@ -859,6 +858,7 @@ std::shared_ptr<DecryptVerifyResult> AbstractDecryptVerifyTask::fromVerifyDetach
 {
     return std::shared_ptr<DecryptVerifyResult>(new DecryptVerifyResult(Verify, //
                                                                         vr,
+                                                                        d->signerKeys(vr, protocol()),
                                                                         DecryptionResult(),
                                                                         QByteArray(),
                                                                         {},
@@ -875,6 +875,7 @@ AbstractDecryptVerifyTask::fromVerifyDetachedResult(const GpgME::Error &err, con
 {
     return std::shared_ptr<DecryptVerifyResult>(new DecryptVerifyResult(Verify, //
                                                                         VerificationResult(err),
+                                                                        {},
                                                                         DecryptionResult(),
                                                                         QByteArray(),
                                                                         {},
@@ -889,6 +890,7 @@ AbstractDecryptVerifyTask::fromVerifyDetachedResult(const GpgME::Error &err, con
 
 DecryptVerifyResult::DecryptVerifyResult(DecryptVerifyOperation type,
                                          const VerificationResult &vr,
+                                         const std::vector<Key> &signers,
                                          const DecryptionResult &dr,
                                          const QByteArray &stuff,
                                          const QString &fileName,
@@ -900,7 +902,7 @@ DecryptVerifyResult::DecryptVerifyResult(DecryptVerifyOperation type,
                                          Task *parentTask,
                                          const Mailbox &informativeSender)
     : Task::Result()
-    , d(new Private(type, vr, dr, stuff, fileName, error, errString, inputLabel, outputLabel, auditLog, parentTask, informativeSender, this))
+    , d(new Private(type, vr, signers, dr, stuff, fileName, error, errString, inputLabel, outputLabel, auditLog, parentTask, informativeSender, this))
 {
 }
 
@@ -978,7 +980,12 @@ QString DecryptVerifyResult::errorString() const
 
 AuditLogEntry DecryptVerifyResult::auditLog() const
 {
-    return d->m_auditLog;
+    return d->m_auditLog.entry();
+}
+
+bool DecryptVerifyResult::hasAuditLog() const
+{
+    return d->m_auditLog.isAvailable();
 }
 
 QPointer<Task> DecryptVerifyResult::parentTask() const
@@ -1012,8 +1019,17 @@ QString DecryptVerifyResult::fileName() const
 class AbstractDecryptVerifyTask::Private
 {
 public:
+    std::vector<Key> signerKeys(const VerificationResult &result, Protocol protocol)
+    {
+        if (!signerKeyResolver) {
+            signerKeyResolver = std::make_shared<SignerKeyResolver>();
+        }
+        return signerKeyResolver->resolve(result, protocol);
+    }
+
     Mailbox informativeSender;
     QPointer<QGpgME::Job> job;
+    std::shared_ptr<SignerKeyResolver> signerKeyResolver;
 };
 
 AbstractDecryptVerifyTask::AbstractDecryptVerifyTask(QObject *parent)
@@ -1044,6 +1060,11 @@ void AbstractDecryptVerifyTask::setInformativeSender(const Mailbox &sender)
     d->informativeSender = sender;
 }
 
+void AbstractDecryptVerifyTask::setSignerKeyResolver(const std::shared_ptr<SignerKeyResolver> &resolver)
+{
+    d->signerKeyResolver = resolver;
+}
+
 QGpgME::Job *AbstractDecryptVerifyTask::job() const
 {
     return d->job;
@@ -1082,7 +1103,6 @@ public:
 
 void DecryptVerifyTask::Private::slotResult(const DecryptionResult &dr, const VerificationResult &vr, const QByteArray &plainText)
 {
-    updateKeys(vr);
     {
         std::stringstream ss;
         ss << dr << '\n' << vr;
@@ -1095,6 +1115,7 @@ void DecryptVerifyTask::Private::slotResult(const DecryptionResult &dr, const Ve
         } else {
             try {
                 kleo_assert(!dr.isNull() || !vr.isNull());
+                m_output->setFileSyncList(q->fileSyncList());
                 m_output->finalize();
             } catch (const GpgME::Exception &e) {
                 q->emitResult(q->fromDecryptResult(e.error(), QString::fromLocal8Bit(e.what()), auditLog));
@@ -1377,6 +1398,7 @@ void DecryptTask::Private::slotResult(const DecryptionResult &result, const QByt
     } else {
         try {
             kleo_assert(!result.isNull());
+            m_output->setFileSyncList(q->fileSyncList());
             m_output->finalize();
         } catch (const GpgME::Exception &e) {
             q->emitResult(q->fromDecryptResult(e.error(), QString::fromLocal8Bit(e.what()), auditLog));
@@ -1516,7 +1538,6 @@ public:
 
 void VerifyOpaqueTask::Private::slotResult(const VerificationResult &result, const QByteArray &plainText)
 {
-    updateKeys(result);
     {
         std::stringstream ss;
         ss << result;
@@ -1529,6 +1550,7 @@ void VerifyOpaqueTask::Private::slotResult(const VerificationResult &result, con
         } else {
             try {
                 kleo_assert(!result.isNull());
+                m_output->setFileSyncList(q->fileSyncList());
                 m_output->finalize();
             } catch (const GpgME::Exception &e) {
                 q->emitResult(q->fromVerifyOpaqueResult(e.error(), QString::fromLocal8Bit(e.what()), auditLog));
@@ -1760,7 +1782,6 @@ public:
 
 void VerifyDetachedTask::Private::slotResult(const VerificationResult &result)
 {
-    updateKeys(result);
     {
         std::stringstream ss;
         ss << result;
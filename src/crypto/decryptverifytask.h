@@ -16,6 +16,7 @@
 #include <gpgme++/verificationresult.h>
 
 #include <memory>
+#include <vector>
 
 namespace KMime
 {
@@ -50,6 +51,7 @@ namespace Crypto
 {
 
 class DecryptVerifyResult;
+class SignerKeyResolver;
 
 class AbstractDecryptVerifyTask : public Task
 {
@@ -62,6 +64,13 @@ public:
     KMime::Types::Mailbox informativeSender() const;
     void setInformativeSender(const KMime::Types::Mailbox &senders);
 
+    /**
+     * Sets the resolver used for looking up the certificates of the signers.
+     * Tasks that share a resolver look up each signer at most once. By
+     * default, each task uses its own resolver.
+     */
+    void setSignerKeyResolver(const std::shared_ptr<SignerKeyResolver> &resolver);
+
     virtual QString inputLabel() const = 0;
     virtual QString outputLabel() const = 0;
 
@@ -243,6 +252,7 @@ public:
     QString errorString() const override;
     VisualCode code() const override;
     AuditLogEntry auditLog() const override;
+    bool hasAuditLog() const override;
     QPointer<Task> parentTask() const override;
     Task::Result::ContentType viewableContentType() const override;
 
@@ -257,6 +267,7 @@ private:
 
     DecryptVerifyResult(DecryptVerifyOperation op,
                         const GpgME::VerificationResult &vr,
+                        const std::vector<GpgME::Key> &signers,
                         const GpgME::DecryptionResult &dr,
                         const QByteArray &stuff,
                         const QString &fileName,
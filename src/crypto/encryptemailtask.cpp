@@ -11,6 +11,7 @@
 
 #include "encryptemailtask.h"
 
+#include <utils/compressedauditlogentry.h>
 #include <utils/input.h>
 #include <utils/kleo_assert.h>
 #include <utils/output.h>
@@ -39,7 +40,7 @@ namespace
 class EncryptEMailResult : public Task::Result
 {
     const EncryptionResult m_result;
-    const AuditLogEntry m_auditLog;
+    const CompressedAuditLogEntry m_auditLog;
 
 public:
     EncryptEMailResult(const EncryptionResult &r, const AuditLogEntry &auditLog)
@@ -55,6 +56,7 @@ public:
     QString errorString() const override;
     VisualCode code() const override;
     AuditLogEntry auditLog() const override;
+    bool hasAuditLog() const override;
 };
 
 QString makeResultString(const EncryptionResult &res)
@@ -224,7 +226,12 @@ QString EncryptEMailResult::errorString() const
 
 AuditLogEntry EncryptEMailResult::auditLog() const
 {
-    return m_auditLog;
+    return m_auditLog.entry();
+}
+
+bool EncryptEMailResult::hasAuditLog() const
+{
+    return m_auditLog.isAvailable();
 }
 
 Task::Result::VisualCode EncryptEMailResult::code() const
@@ -14,6 +14,7 @@
 #include "commands/detailscommand.h"
 #include "dialogs/groupdetailsdialog.h"
 #include "utils/accessibility.h"
+#include "utils/keysearchindex.h"
 
 #include <QAccessible>
 #include <QAction>
@@ -47,6 +48,11 @@
 #include <QMenu>
 #include <QToolButton>
 
+#include <map>
+#include <memory>
+#include <optional>
+#include <vector>
+
 using namespace Kleo;
 using namespace GpgME;
 
@@ -186,6 +192,190 @@ private:
     }
 };
 
+/**
+ * Filters the shared sorted completion model for one line edit by the key
+ * filter of the line edit and by the search text. It doesn't sort.
+ *
+ * The search index doesn't contain everything shown in the completions (e.g.
+ * the validity and the creation date), so rows not matched by the index are
+ * matched against the completion text like QCompleter does with
+ * Qt::MatchContains. This ensures that the pre-filter never hides a row
+ * that QCompleter would show. The lower-cased completion texts are cached
+ * until the rows of the source model change.
+ */
+class CompletionFilterModel : public KeyListSortFilterProxyModel
+{
+    Q_OBJECT
+
+public:
+    CompletionFilterModel(QObject *parent = nullptr)
+        : KeyListSortFilterProxyModel(parent)
+    {
+        connect(KeySearchIndexProvider::instance(), &KeySearchIndexProvider::indexChanged, this, [this]() {
+            if (!mSearchResult.needle().isEmpty()) {
+                mSearchResult = KeySearchResult::search(mSearchResult.needle());
+                invalidateFilter();
+            }
+        });
+    }
+
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override
+    {
+        Q_UNUSED(parent)
+        // see CompletionProxyModel::columnCount()
+        return 1;
+    }
+
+    void setSourceModel(QAbstractItemModel *model) override
+    {
+        for (const auto &connection : mSourceConnections) {
+            disconnect(connection);
+        }
+        mSourceConnections.clear();
+        mCompletionTexts.clear();
+        if (model) {
+            // connect before the base class, so that the cached texts are
+            // dropped before the changed rows are filtered
+            const auto clearCompletionTexts = [this]() {
+                mCompletionTexts.clear();
+            };
+            mSourceConnections = {
+                connect(model, &QAbstractItemModel::modelAboutToBeReset, this, clearCompletionTexts),
+                connect(model, &QAbstractItemModel::layoutAboutToBeChanged, this, clearCompletionTexts),
+                connect(model, &QAbstractItemModel::rowsAboutToBeInserted, this, clearCompletionTexts),
+                connect(model, &QAbstractItemModel::rowsAboutToBeRemoved, this, clearCompletionTexts),
+                connect(model, &QAbstractItemModel::rowsAboutToBeMoved, this, clearCompletionTexts),
+                connect(model,
+                        &QAbstractItemModel::dataChanged,
+                        this,
+                        [this](const QModelIndex &topLeft, const QModelIndex &bottomRight) {
+                            for (int row = topLeft.row(); row <= bottomRight.row() && row < int(mCompletionTexts.size()); ++row) {
+                                mCompletionTexts[row].reset();
+                            }
+                        }),
+            };
+        }
+        KeyListSortFilterProxyModel::setSourceModel(model);
+    }
+
+    // pre-filters the completions with the search index, so that QCompleter
+    // only needs to look at the few matching user IDs
+    void setSearchText(const QString &text)
+    {
+        if (KeySearchIndex::normalizedSearchText(text) == mSearchResult.needle()) {
+            return;
+        }
+        mSearchResult = KeySearchResult::search(text);
+        invalidateFilter();
+    }
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override
+    {
+        if (!KeyListSortFilterProxyModel::filterAcceptsRow(sourceRow, sourceParent)) {
+            return false;
+        }
+        if (mSearchResult.needle().isEmpty()) {
+            return true;
+        }
+        const QModelIndex index = sourceModel()->index(sourceRow, 0, sourceParent);
+        return matchesSearchIndex(index) || completionText(index).contains(mSearchResult.needle());
+    }
+
+private:
+    bool matchesSearchIndex(const QModelIndex &index) const
+    {
+        const auto userID = index.data(KeyList::UserIDRole).value<GpgME::UserID>();
+        if (!userID.isNull()) {
+            return mSearchResult.matches(userID);
+        }
+        const auto key = index.data(KeyList::KeyRole).value<GpgME::Key>();
+        if (!key.isNull()) {
+            return mSearchResult.matches(key);
+        }
+        const auto group = index.data(KeyList::GroupRole).value<KeyGroup>();
+        if (!group.isNull()) {
+            return mSearchResult.matches(group);
+        }
+        return true;
+    }
+
+    // returns the lower-cased text that QCompleter matches against (see CompletionProxyModel::data())
+    const QString &completionText(const QModelIndex &index) const
+    {
+        const auto row = static_cast<std::size_t>(index.row());
+        if (row >= mCompletionTexts.size()) {
+            mCompletionTexts.resize(row + 1);
+        }
+        auto &text = mCompletionTexts[row];
+        if (!text) {
+            text = index.data(Qt::EditRole).toString().toLower();
+        }
+        return *text;
+    }
+
+private:
+    KeySearchResult mSearchResult;
+    // the completion texts of the rows of the (flat) source model
+    mutable std::vector<std::optional<QString>> mCompletionTexts;
+    std::vector<QMetaObject::Connection> mSourceConnections;
+};
+
+/**
+ * The models shared by all line edits using the same key list model, e.g.
+ * all recipient line edits of a SignEncryptWidget. The sorted completion
+ * model is only created when it's needed for the first time.
+ */
+class CompletionModels
+{
+public:
+    explicit CompletionModels(AbstractKeyListModel *model)
+        : mModel{model}
+    {
+        mUserIDModel.setSourceModel(model);
+    }
+
+    AbstractKeyListModel *keyListModel() const
+    {
+        return mModel;
+    }
+
+    UserIDProxyModel *userIDModel()
+    {
+        return &mUserIDModel;
+    }
+
+    CompletionProxyModel *sortedCompletionModel()
+    {
+        if (!mSortedCompletionModel) {
+            mSortedCompletionModel = std::make_unique<CompletionProxyModel>();
+            mSortedCompletionModel->setSourceModel(&mUserIDModel);
+            // initialize dynamic sorting
+            mSortedCompletionModel->sort(0);
+        }
+        return mSortedCompletionModel.get();
+    }
+
+private:
+    QPointer<AbstractKeyListModel> mModel;
+    UserIDProxyModel mUserIDModel;
+    std::unique_ptr<CompletionProxyModel> mSortedCompletionModel;
+};
+
+std::shared_ptr<CompletionModels> sharedCompletionModels(AbstractKeyListModel *model)
+{
+    static std::map<AbstractKeyListModel *, std::weak_ptr<CompletionModels>> s_completionModels;
+    std::erase_if(s_completionModels, [](const auto &entry) {
+        return entry.second.expired();
+    });
+    if (auto models = s_completionModels[model].lock(); models && models->keyListModel() == model) {
+        return models;
+    }
+    auto models = std::make_shared<CompletionModels>(model);
+    s_completionModels[model] = models;
+    return models;
+}
+
 auto createSeparatorAction(QObject *parent)
 {
     auto action = new QAction{parent};
@@ -229,6 +419,7 @@ public:
     void setAccessibleName(const QString &s);
 
 private:
+    void ensureCompletionModel();
     void updateKey(CursorPositioning positioning);
     void editChanged();
     void editFinished();
@@ -266,9 +457,9 @@ public:
 
 private:
     QString mAccessibleName;
-    UserIDProxyModel *const mUserIdProxyModel;
+    std::shared_ptr<CompletionModels> mCompletionModels;
     KeyListSortFilterProxyModel *const mFilterModel;
-    CompletionProxyModel *const mCompleterFilterModel;
+    CompletionFilterModel *mCompleterFilterModel = nullptr;
     QCompleter *mCompleter = nullptr;
     std::shared_ptr<KeyFilter> mFilter;
     QAction *const mStatusAction;
@@ -280,9 +471,8 @@ private:
 CertificateLineEdit::Private::Private(CertificateLineEdit *qq, AbstractKeyListModel *model, KeyUsage::Flags usage, KeyFilter *filter)
     : q{qq}
     , ui{qq}
-    , mUserIdProxyModel{new UserIDProxyModel{qq}}
+    , mCompletionModels{sharedCompletionModels(model)}
     , mFilterModel{new KeyListSortFilterProxyModel{qq}}
-    , mCompleterFilterModel{new CompletionProxyModel{qq}}
     , mCompleter{new QCompleter{qq}}
     , mFilter{std::shared_ptr<KeyFilter>{filter}}
     , mStatusAction{new QAction{qq}}
@@ -294,13 +484,7 @@ CertificateLineEdit::Private::Private(CertificateLineEdit *qq, AbstractKeyListMo
     ui.lineEdit.setContextMenuPolicy(Qt::CustomContextMenu);
     ui.lineEdit.addAction(mStatusAction, QLineEdit::LeadingPosition);
 
-    mUserIdProxyModel->setSourceModel(model);
-
-    mCompleterFilterModel->setKeyFilter(mFilter);
-    mCompleterFilterModel->setSourceModel(mUserIdProxyModel);
-    // initialize dynamic sorting
-    mCompleterFilterModel->sort(0);
-    mCompleter->setModel(mCompleterFilterModel);
+    // the completion model is set when the user starts typing
     mCompleter->setFilterMode(Qt::MatchContains);
     mCompleter->setCaseSensitivity(Qt::CaseInsensitive);
     ui.lineEdit.setCompleter(mCompleter);
@@ -329,13 +513,18 @@ CertificateLineEdit::Private::Private(CertificateLineEdit *qq, AbstractKeyListMo
     mShowDetailsAction->setText(i18nc("@action:inmenu", "Show Details"));
     mShowDetailsAction->setEnabled(false);
 
-    mFilterModel->setSourceModel(mUserIdProxyModel);
+    mFilterModel->setSourceModel(mCompletionModels->userIDModel());
     mFilterModel->setFilterKeyColumn(KeyList::Summary);
     if (filter) {
         mFilterModel->setKeyFilter(mFilter);
     }
 
     connect(KeyCache::instance().get(), &Kleo::KeyCache::keysMayHaveChanged, q, [this]() {
+        // there is nothing to update for empty line edits, e.g. the empty
+        // recipient line edit at the end of a long list of recipients
+        if (mStatus == Status::Empty && ui.lineEdit.text().isEmpty()) {
+            return;
+        }
         updateKey(CursorPositioning::KeepPosition);
     });
     connect(KeyCache::instance().get(), &Kleo::KeyCache::groupUpdated, q, [this](const KeyGroup &group) {
@@ -373,7 +562,13 @@ CertificateLineEdit::Private::Private(CertificateLineEdit *qq, AbstractKeyListMo
             },
             Qt::QueuedConnection);
     });
-    connect(&ui.lineEdit, &QLineEdit::textChanged, q, [this]() {
+    connect(&ui.lineEdit, &QLineEdit::textChanged, q, [this](const QString &text) {
+        if (!text.isEmpty()) {
+            ensureCompletionModel();
+        }
+        if (mCompleterFilterModel) {
+            mCompleterFilterModel->setSearchText(text);
+        }
         editChanged();
     });
     connect(&ui.lineEdit, &QLineEdit::customContextMenuRequested, q, [this](const QPoint &pos) {
@@ -533,6 +728,17 @@ void CertificateLineEdit::Private::onLocateJobResult(QGpgME::Job *job, const QSt
     }
 }
 
+void CertificateLineEdit::Private::ensureCompletionModel()
+{
+    if (mCompleterFilterModel) {
+        return;
+    }
+    mCompleterFilterModel = new CompletionFilterModel{q};
+    mCompleterFilterModel->setKeyFilter(mFilter);
+    mCompleterFilterModel->setSourceModel(mCompletionModels->sortedCompletionModel());
+    mCompleter->setModel(mCompleterFilterModel);
+}
+
 void CertificateLineEdit::Private::updateKey(CursorPositioning positioning)
 {
     static const _detail::ByFingerprint<std::equal_to> keysHaveSameFingerprint;
@@ -886,7 +1092,9 @@ void CertificateLineEdit::Private::setKeyFilter(const std::shared_ptr<KeyFilter>
 {
     mFilter = filter;
     mFilterModel->setKeyFilter(filter);
-    mCompleterFilterModel->setKeyFilter(mFilter);
+    if (mCompleterFilterModel) {
+        mCompleterFilterModel->setKeyFilter(mFilter);
+    }
     updateKey(CursorPositioning::Default);
 }
 
@@ -0,0 +1,233 @@
+/* -*- mode: c++; c-basic-offset:4 -*-
+    crypto/gui/resultitemdelegate.cpp
+
+    This file is part of Kleopatra, the KDE keymanager
+    SPDX-FileCopyrightText: 2024 g10 Code GmbH
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <config-kleopatra.h>
+
+#include "resultitemdelegate.h"
+
+#include "resultitemwidget.h"
+#include "resultlistmodel.h"
+
+#include <Libkleo/SystemInfo>
+
+#include <KLocalizedString>
+
+#include <QAbstractItemView>
+#include <QAbstractTextDocumentLayout>
+#include <QCache>
+#include <QPainter>
+#include <QPersistentModelIndex>
+#include <QPointer>
+#include <QTextDocument>
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+using namespace Kleo;
+using namespace Kleo::Crypto;
+using namespace Kleo::Crypto::Gui;
+
+namespace
+{
+// the margin around the frame and the padding inside the frame
+static const int margin = 2;
+static const int padding = 5;
+// the number of laid out documents kept for painting the visible items
+static const int maxCachedDocuments = 200;
+
+static int availableWidth(const QStyleOptionViewItem &option)
+{
+    if (const auto view = qobject_cast<const QAbstractItemView *>(option.widget)) {
+        return view->viewport()->width();
+    }
+    return option.rect.width();
+}
+
+static int textWidth(int width)
+{
+    return std::max(width - 2 * (margin + padding), 1);
+}
+}
+
+class ResultItemDelegate::Private
+{
+    friend class ::Kleo::Crypto::Gui::ResultItemDelegate;
+    ResultItemDelegate *const q;
+
+public:
+    explicit Private(ResultItemDelegate *qq);
+
+private:
+    QTextDocument *document(const Task::Result *result, int width);
+    int height(const Task::Result *result, int width);
+
+private:
+    QCache<const Task::Result *, QTextDocument> documents{maxCachedDocuments};
+    // the height of the documents (by width) of all results
+    std::unordered_map<const Task::Result *, std::pair<int, int>> heights;
+
+    QPointer<ResultItemWidget> editor;
+    QPersistentModelIndex editorIndex;
+};
+
+ResultItemDelegate::Private::Private(ResultItemDelegate *qq)
+    : q{qq}
+{
+}
+
+QTextDocument *ResultItemDelegate::Private::document(const Task::Result *result, int width)
+{
+    QTextDocument *doc = documents.object(result);
+    if (!doc) {
+        doc = new QTextDocument;
+        const QColor txtColor = txtColorForVisualCode(result->code());
+        if (!SystemInfo::isHighContrastModeActive()) {
+            doc->setDefaultStyleSheet(QStringLiteral("body, a { color: %1; }").arg(txtColor.name()));
+        }
+        doc->setDocumentMargin(0);
+        const QString details = result->details();
+        doc->setHtml(details.isEmpty() ? result->overview() : result->overview() + QLatin1StringView("<br/>") + details);
+        documents.insert(result, doc);
+    }
+    if (doc->textWidth() != textWidth(width)) {
+        doc->setTextWidth(textWidth(width));
+    }
+    return doc;
+}
+
+int ResultItemDelegate::Private::height(const Task::Result *result, int width)
+{
+    auto it = heights.find(result);
+    if (it == heights.end() || it->second.first != width) {
+        const int h = static_cast<int>(std::ceil(document(result, width)->size().height())) + 2 * (margin + padding);
+        it = heights.insert_or_assign(result, std::make_pair(width, h)).first;
+    }
+    return it->second.second;
+}
+
+ResultItemDelegate::ResultItemDelegate(QObject *parent)
+    : QStyledItemDelegate{parent}
+    , d{new Private{this}}
+{
+}
+
+ResultItemDelegate::~ResultItemDelegate() = default;
+
+void ResultItemDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    const auto result = ResultListModel::result(index);
+    if (!result) {
+        QStyledItemDelegate::paint(painter, option, index);
+        return;
+    }
+    if (index == d->editorIndex && d->editor && d->editor->isVisible()) {
+        // the editor paints the item
+        return;
+    }
+
+    painter->save();
+    painter->setRenderHint(QPainter::Antialiasing);
+    const QRect frameRect = option.rect.adjusted(margin, margin, -margin, -margin);
+    const QColor color = colorForVisualCode(result->code());
+    if (SystemInfo::isHighContrastModeActive()) {
+        painter->setBrush(Qt::NoBrush);
+        painter->setPen(option.palette.color(QPalette::Text));
+    } else {
+        painter->setBrush(color);
+        painter->setPen(color.darker(150));
+    }
+    painter->drawRoundedRect(QRectF{frameRect}.adjusted(0.5, 0.5, -0.5, -0.5), 3, 3);
+
+    QTextDocument *doc = d->document(result.get(), option.rect.width());
+    painter->translate(frameRect.topLeft() + QPoint{padding, padding});
+    painter->setClipRect(QRect{QPoint{}, frameRect.size() - QSize{padding, padding}});
+    QAbstractTextDocumentLayout::PaintContext context;
+    context.palette = option.palette;
+    if (!SystemInfo::isHighContrastModeActive()) {
+        context.palette.setColor(QPalette::Text, txtColorForVisualCode(result->code()));
+    }
+    doc->documentLayout()->draw(painter, context);
+    painter->restore();
+}
+
+QSize ResultItemDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    const auto result = ResultListModel::result(index);
+    if (!result) {
+        return QStyledItemDelegate::sizeHint(option, index);
+    }
+    const int width = availableWidth(option);
+    int height = d->height(result.get(), width);
+    if (index == d->editorIndex && d->editor) {
+        const int editorHeight = d->editor->hasHeightForWidth() ? d->editor->heightForWidth(width) : d->editor->sizeHint().height();
+        height = std::max(height, editorHeight);
+    }
+    return {width, height};
+}
+
+QWidget *ResultItemDelegate::createEditor(QWidget *parent, const QStyleOptionViewItem &, const QModelIndex &index) const
+{
+    const auto result = ResultListModel::result(index);
+    if (!result) {
+        return nullptr;
+    }
+    auto editor = new ResultItemWidget{result, parent};
+    editor->setAutoFillBackground(true);
+    connect(editor, &ResultItemWidget::linkActivated, this, &ResultItemDelegate::linkActivated);
+    connect(editor, &ResultItemWidget::closeButtonClicked, this, &ResultItemDelegate::closeButtonClicked);
+    const auto viewableContentType = result->viewableContentType();
+    if (viewableContentType == Task::Result::ContentType::Mime || viewableContentType == Task::Result::ContentType::Mbox) {
+        editor->setShowButton(i18nc("@action:button", "Show Email"), true);
+        connect(editor, &ResultItemWidget::showButtonClicked, this, [this, result]() {
+            Q_EMIT const_cast<ResultItemDelegate *>(this)->showButtonClicked(result);
+        });
+    }
+    d->editor = editor;
+    d->editorIndex = index;
+    // the size of the item changes to the size of the editor
+    QMetaObject::invokeMethod(
+        const_cast<ResultItemDelegate *>(this),
+        [this, index = QPersistentModelIndex{index}]() {
+            if (index.isValid()) {
+                Q_EMIT const_cast<ResultItemDelegate *>(this)->sizeHintChanged(index);
+            }
+        },
+        Qt::QueuedConnection);
+    return editor;
+}
+
+void ResultItemDelegate::destroyEditor(QWidget *editor, const QModelIndex &index) const
+{
+    if (editor == d->editor) {
+        d->editor = nullptr;
+        d->editorIndex = {};
+    }
+    QStyledItemDelegate::destroyEditor(editor, index);
+    if (index.isValid()) {
+        Q_EMIT const_cast<ResultItemDelegate *>(this)->sizeHintChanged(index);
+    }
+}
+
+void ResultItemDelegate::setEditorData(QWidget *, const QModelIndex &) const
+{
+    // the results are read-only
+}
+
+void ResultItemDelegate::setModelData(QWidget *, QAbstractItemModel *, const QModelIndex &) const
+{
+    // the results are read-only
+}
+
+void ResultItemDelegate::updateEditorGeometry(QWidget *editor, const QStyleOptionViewItem &option, const QModelIndex &) const
+{
+    editor->setGeometry(option.rect);
+}
+
+#include "moc_resultitemdelegate.cpp"
@@ -0,0 +1,59 @@
+/* -*- mode: c++; c-basic-offset:4 -*-
+    crypto/gui/resultitemdelegate.h
+
+    This file is part of Kleopatra, the KDE keymanager
+    SPDX-FileCopyrightText: 2024 g10 Code GmbH
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <crypto/task.h>
+
+#include <QStyledItemDelegate>
+
+#include <memory>
+
+namespace Kleo
+{
+namespace Crypto
+{
+namespace Gui
+{
+
+/**
+ * Renders the items of a ResultListModel like ResultItemWidget does, but
+ * without creating widgets for them. Only the current item is shown with a
+ * real ResultItemWidget (as editor), so that its links and buttons can be
+ * used.
+ */
+class ResultItemDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+public:
+    explicit ResultItemDelegate(QObject *parent = nullptr);
+    ~ResultItemDelegate() override;
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+    QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+
+    QWidget *createEditor(QWidget *parent, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+    void destroyEditor(QWidget *editor, const QModelIndex &index) const override;
+    void setEditorData(QWidget *editor, const QModelIndex &index) const override;
+    void setModelData(QWidget *editor, QAbstractItemModel *model, const QModelIndex &index) const override;
+    void updateEditorGeometry(QWidget *editor, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+
+Q_SIGNALS:
+    void linkActivated(const QString &link);
+    void showButtonClicked(const std::shared_ptr<const Task::Result> &result);
+    void closeButtonClicked();
+
+private:
+    class Private;
+    const std::unique_ptr<Private> d;
+};
+
+}
+}
+}
@@ -44,10 +44,7 @@ using namespace Kleo;
 using namespace Kleo::Crypto;
 using namespace Kleo::Crypto::Gui;
 
-namespace
-{
-// TODO move out of here
-static QColor colorForVisualCode(Task::Result::VisualCode code)
+QColor Kleo::Crypto::Gui::colorForVisualCode(Task::Result::VisualCode code)
 {
     switch (code) {
     case Task::Result::AllGood:
@@ -62,7 +59,8 @@ static QColor colorForVisualCode(Task::Result::VisualCode code)
         return QColor(0x00, 0x80, 0xFF); // light blue
     }
 }
-static QColor txtColorForVisualCode(Task::Result::VisualCode code)
+
+QColor Kleo::Crypto::Gui::txtColorForVisualCode(Task::Result::VisualCode code)
 {
     switch (code) {
     case Task::Result::AllGood:
@@ -76,7 +74,6 @@ static QColor txtColorForVisualCode(Task::Result::VisualCode code)
         return QColor(0xFF, 0xFF, 0xFF); // white
     }
 }
-}
 
 class ResultItemWidget::Private
 {
@@ -216,7 +213,7 @@ void ResultItemWidget::Private::addKeyImportButton(QBoxLayout *lay, bool search)
     }
 }
 
-static QUrl auditlog_url_template()
+static QUrl auditlog_url()
 {
     QUrl url(QStringLiteral("kleoresultitem://showauditlog"));
     return url;
@@ -224,11 +221,12 @@ static QUrl auditlog_url_template()
 
 void ResultItemWidget::Private::updateShowDetailsLabel()
 {
-    const auto auditLogUrl = m_result->auditLog().asUrl(auditlog_url_template());
+    // the audit log itself is only requested when the link is activated
+    const bool hasAuditLog = m_result->hasAuditLog();
     const auto auditLogLinkText = m_result->hasError() ? i18n("Diagnostics") //
                                                        : i18nc("The Audit Log is a detailed error log from the gnupg backend", "Show Audit Log");
-    m_auditLogLabel->setUrl(auditLogUrl, auditLogLinkText);
-    m_auditLogLabel->setVisible(!auditLogUrl.isEmpty());
+    m_auditLogLabel->setUrl(hasAuditLog ? auditlog_url() : QUrl{}, auditLogLinkText);
+    m_auditLogLabel->setVisible(hasAuditLog);
 }
 
 ResultItemWidget::ResultItemWidget(const std::shared_ptr<const Task::Result> &result, QWidget *parent, Qt::WindowFlags flags)
@@ -9,6 +9,7 @@
 
 #pragma once
 
+#include <QColor>
 #include <QWidget>
 
 #include <crypto/task.h>
@@ -27,6 +28,13 @@ class Task;
 namespace Gui
 {
 
+/**
+ * Returns the background color and the text color used for showing results
+ * with the visual code @p code.
+ */
+QColor colorForVisualCode(Task::Result::VisualCode code);
+QColor txtColorForVisualCode(Task::Result::VisualCode code);
+
 class ResultItemWidget : public QWidget
 {
     Q_OBJECT
@@ -0,0 +1,83 @@
+/* -*- mode: c++; c-basic-offset:4 -*-
+    crypto/gui/resultlistmodel.cpp
+
+    This file is part of Kleopatra, the KDE keymanager
+    SPDX-FileCopyrightText: 2024 g10 Code GmbH
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <config-kleopatra.h>
+
+#include "resultlistmodel.h"
+
+#include <QTextDocumentFragment>
+
+#include <algorithm>
+
+using namespace Kleo;
+using namespace Kleo::Crypto;
+using namespace Kleo::Crypto::Gui;
+
+ResultListModel::ResultListModel(QObject *parent)
+    : QAbstractListModel{parent}
+{
+}
+
+ResultListModel::~ResultListModel() = default;
+
+void ResultListModel::addResult(const std::shared_ptr<const Task::Result> &result)
+{
+    Q_ASSERT(result);
+    // insert new result after the last result with error or at the end
+    const int row = result->hasError() ? m_numErrorResults++ : static_cast<int>(m_results.size());
+    beginInsertRows({}, row, row);
+    m_results.insert(m_results.begin() + row, result);
+    endInsertRows();
+}
+
+int ResultListModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : static_cast<int>(m_results.size());
+}
+
+QVariant ResultListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= static_cast<int>(m_results.size())) {
+        return {};
+    }
+    const auto &result = m_results[index.row()];
+    switch (role) {
+    case Qt::DisplayRole:
+    case Qt::AccessibleTextRole:
+        return QTextDocumentFragment::fromHtml(result->overview()).toPlainText();
+    case ResultRole:
+        return QVariant::fromValue(result);
+    case VisualCodeRole:
+        return static_cast<int>(result->code());
+    }
+    return {};
+}
+
+std::shared_ptr<const Task::Result> ResultListModel::result(const QModelIndex &index)
+{
+    return index.data(ResultRole).value<std::shared_ptr<const Task::Result>>();
+}
+
+void ResultListFilterModel::setVisualCodes(const std::vector<Task::Result::VisualCode> &codes)
+{
+    m_visualCodes = codes;
+    invalidateFilter();
+}
+
+bool ResultListFilterModel::filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const
+{
+    if (m_visualCodes.empty()) {
+        return true;
+    }
+    const QModelIndex index = sourceModel()->index(sourceRow, 0, sourceParent);
+    const auto code = static_cast<Task::Result::VisualCode>(index.data(ResultListModel::VisualCodeRole).toInt());
+    return std::find(m_visualCodes.begin(), m_visualCodes.end(), code) != m_visualCodes.end();
+}
+
+#include "moc_resultlistmodel.cpp"
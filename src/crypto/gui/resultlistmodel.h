@@ -0,0 +1,79 @@
+/* -*- mode: c++; c-basic-offset:4 -*-
+    crypto/gui/resultlistmodel.h
+
+    This file is part of Kleopatra, the KDE keymanager
+    SPDX-FileCopyrightText: 2024 g10 Code GmbH
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <crypto/task.h>
+
+#include <QAbstractListModel>
+#include <QSortFilterProxyModel>
+
+#include <memory>
+#include <vector>
+
+namespace Kleo
+{
+namespace Crypto
+{
+namespace Gui
+{
+
+/**
+ * A list model of the results of tasks. Like in ResultListWidget, results
+ * with errors are listed before all other results.
+ */
+class ResultListModel : public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    enum Role {
+        ResultRole = Qt::UserRole + 1,
+        VisualCodeRole,
+    };
+
+    explicit ResultListModel(QObject *parent = nullptr);
+    ~ResultListModel() override;
+
+    void addResult(const std::shared_ptr<const Task::Result> &result);
+
+    int rowCount(const QModelIndex &parent = {}) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    static std::shared_ptr<const Task::Result> result(const QModelIndex &index);
+
+private:
+    std::vector<std::shared_ptr<const Task::Result>> m_results;
+    int m_numErrorResults = 0;
+};
+
+/**
+ * Filters a ResultListModel by the visual code of the results.
+ */
+class ResultListFilterModel : public QSortFilterProxyModel
+{
+    Q_OBJECT
+public:
+    using QSortFilterProxyModel::QSortFilterProxyModel;
+
+    /**
+     * Shows only the results with one of the given visual codes. If
+     * @p codes is empty, then all results are shown.
+     */
+    void setVisualCodes(const std::vector<Task::Result::VisualCode> &codes);
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override;
+
+private:
+    std::vector<Task::Result::VisualCode> m_visualCodes;
+};
+
+}
+}
+}
@@ -14,7 +14,9 @@
 #include "emailoperationspreferences.h"
 
 #include <crypto/decryptverifytask.h>
+#include <crypto/gui/resultitemdelegate.h>
 #include <crypto/gui/resultitemwidget.h>
+#include <crypto/gui/resultlistmodel.h>
 
 #include <utils/gui-helper.h>
 #include <utils/scrollarea.h>
@@ -25,7 +27,10 @@
 #include <KStandardGuiItem>
 #include <QPushButton>
 
+#include <QComboBox>
+#include <QHBoxLayout>
 #include <QLabel>
+#include <QListView>
 #include <QVBoxLayout>
 
 #include <KGuiItem>
@@ -34,6 +39,13 @@ using namespace Kleo;
 using namespace Kleo::Crypto;
 using namespace Kleo::Crypto::Gui;
 
+namespace
+{
+// above this number of tasks the results are shown in a list view which only
+// renders the visible results instead of creating a widget for each result
+static const unsigned int maxResultItemWidgets = 100;
+}
+
 class ResultListWidget::Private
 {
     ResultListWidget *const q;
@@ -47,6 +59,7 @@ public:
 
     void addResultWidget(ResultItemWidget *widget);
     void resizeIfStandalone();
+    void switchToListView();
 
     std::vector<std::shared_ptr<TaskCollection>> m_collections;
     bool m_standaloneMode = false;
@@ -55,6 +68,10 @@ public:
     QPushButton *m_closeButton = nullptr;
     QVBoxLayout *m_layout = nullptr;
     QLabel *m_progressLabel = nullptr;
+    // the results shown by result item widgets
+    std::vector<std::shared_ptr<const Task::Result>> m_widgetResults;
+    ResultListModel *m_model = nullptr;
+    ResultListFilterModel *m_filterModel = nullptr;
 };
 
 ResultListWidget::Private::Private(ResultListWidget *qq)
@@ -135,6 +152,69 @@ void ResultListWidget::Private::addResultWidget(ResultItemWidget *widget)
     resizeIfStandalone();
 }
 
+void ResultListWidget::Private::switchToListView()
+{
+    if (m_model) {
+        return;
+    }
+    m_model = new ResultListModel{q};
+    m_filterModel = new ResultListFilterModel{q};
+    m_filterModel->setSourceModel(m_model);
+
+    auto container = new QWidget;
+    auto containerLayout = new QVBoxLayout{container};
+    containerLayout->setContentsMargins(0, 0, 0, 0);
+
+    auto filterLayout = new QHBoxLayout;
+    auto filterLabel = new QLabel{i18nc("@label:listbox", "Show:")};
+    auto filterCombo = new QComboBox;
+    filterLabel->setBuddy(filterCombo);
+    filterCombo->addItem(i18nc("@item:inlistbox", "All results"));
+    filterCombo->addItem(i18nc("@item:inlistbox", "Errors only"));
+    filterCombo->addItem(i18nc("@item:inlistbox", "Warnings only"));
+    q->connect(filterCombo, &QComboBox::currentIndexChanged, q, [this](int index) {
+        switch (index) {
+        case 1:
+            m_filterModel->setVisualCodes({Task::Result::Danger, Task::Result::NeutralError});
+            break;
+        case 2:
+            m_filterModel->setVisualCodes({Task::Result::Warning});
+            break;
+        default:
+            m_filterModel->setVisualCodes({});
+        }
+    });
+    filterLayout->addWidget(filterLabel);
+    filterLayout->addWidget(filterCombo);
+    filterLayout->addStretch(1);
+    containerLayout->addLayout(filterLayout);
+
+    auto delegate = new ResultItemDelegate{q};
+    q->connect(delegate, &ResultItemDelegate::linkActivated, q, &ResultListWidget::linkActivated);
+    q->connect(delegate, &ResultItemDelegate::showButtonClicked, q, &ResultListWidget::showButtonClicked);
+    q->connect(delegate, &ResultItemDelegate::closeButtonClicked, q, &ResultListWidget::close);
+
+    auto listView = new QListView;
+    listView->setModel(m_filterModel);
+    listView->setItemDelegate(delegate);
+    listView->setResizeMode(QListView::Adjust);
+    listView->setLayoutMode(QListView::Batched);
+    listView->setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
+    listView->setSelectionMode(QAbstractItemView::NoSelection);
+    // the current result is shown with a result item widget, so that its buttons and links can be used
+    listView->setEditTriggers(QAbstractItemView::CurrentChanged);
+    containerLayout->addWidget(listView, 1);
+
+    // the results are moved from the widgets to the model
+    delete m_layout->replaceWidget(m_scrollArea, container);
+    delete m_scrollArea;
+    m_scrollArea = nullptr;
+    for (const auto &result : m_widgetResults) {
+        m_model->addResult(result);
+    }
+    m_widgetResults.clear();
+}
+
 void ResultListWidget::Private::allTasksDone()
 {
     if (!q->isComplete()) {
@@ -151,6 +231,11 @@ void ResultListWidget::Private::result(const std::shared_ptr<const Task::Result>
     Q_ASSERT(std::any_of(m_collections.cbegin(), m_collections.cend(), [](const std::shared_ptr<TaskCollection> &t) {
         return !t->isEmpty();
     }));
+    if (m_model) {
+        m_model->addResult(result);
+        return;
+    }
+    m_widgetResults.push_back(result);
     auto wid = new ResultItemWidget(result);
     q->connect(wid, &ResultItemWidget::linkActivated, q, &ResultListWidget::linkActivated);
     q->connect(wid, &ResultItemWidget::closeButtonClicked, q, &ResultListWidget::close);
@@ -193,6 +278,9 @@ void ResultListWidget::addTaskCollection(const std::shared_ptr<TaskCollection> &
     Q_ASSERT(coll);
     Q_ASSERT(!coll->isEmpty());
     d->m_collections.push_back(coll);
+    if (totalNumberOfTasks() > maxResultItemWidgets) {
+        d->switchToListView();
+    }
     connect(coll.get(),
             SIGNAL(result(std::shared_ptr<const Kleo::Crypto::Task::Result>)),
             this,
@@ -25,6 +25,7 @@
 #include <QHash>
 #include <QHeaderView>
 #include <QLabel>
+#include <QLocale>
 #include <QProgressBar>
 #include <QPushButton>
 #include <QSortFilterProxyModel>
@@ -32,6 +33,8 @@
 #include <QTreeView>
 #include <QVBoxLayout>
 
+#include <limits>
+
 using namespace Kleo;
 using namespace Kleo::Crypto;
 using namespace Kleo::Crypto::Gui;
@@ -321,10 +324,24 @@ private:
 
         void setProgress(int cur, int tot)
         {
+            progressBar.resetFormat();
             progressBar.setMaximum(tot);
             progressBar.setValue(cur);
         }
 
+        void setProcessedBytes(quint64 processed, quint64 total)
+        {
+            // re-scale to fit into ints
+            const quint64 factor = total / std::numeric_limits<int>::max() + 1;
+            progressBar.setMaximum(total / factor);
+            progressBar.setValue(processed / factor);
+            const QLocale locale;
+            progressBar.setFormat(i18nc("@info:progress amount of data processed", //
+                                        "%1 of %2",
+                                        locale.formattedDataSize(processed),
+                                        locale.formattedDataSize(total)));
+        }
+
         bool isProgressBarActive() const
         {
             const int tot = progressBar.maximum();
@@ -372,6 +389,13 @@ void VerifyChecksumsDialog::setProgress(int cur, int tot)
     d->updateErrors();
 }
 
+// slot
+void VerifyChecksumsDialog::setProcessedBytes(quint64 processed, quint64 total)
+{
+    d->ui.setProcessedBytes(processed, total);
+    d->updateErrors();
+}
+
 // slot
 void VerifyChecksumsDialog::setStatus(const QString &file, Status status)
 {
@@ -42,6 +42,7 @@ public:
 public Q_SLOTS:
     void setBaseDirectories(const QStringList &bases);
     void setProgress(int current, int total);
+    void setProcessedBytes(quint64 processed, quint64 total);
     void setStatus(const QString &file, Kleo::Crypto::Gui::VerifyChecksumsDialog::Status status);
     void setErrors(const QStringList &errors);
     void clearStatusInformation();
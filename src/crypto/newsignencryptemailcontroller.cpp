@@ -15,6 +15,7 @@
 #include "recipient.h"
 #include "sender.h"
 #include "signemailtask.h"
+#include "signencryptemailtask.h"
 #include "taskcollection.h"
 
 #include "emailoperationspreferences.h"
@@ -319,6 +320,45 @@ void NewSignEncryptEMailController::startSigning(const std::vector<std::shared_p
     d->startSigning();
 }
 
+bool NewSignEncryptEMailController::canSignAndEncryptInOnePass() const
+{
+    return d->sign && d->encrypt && protocol() == OpenPGP;
+}
+
+void NewSignEncryptEMailController::startSigningAndEncryption(const std::vector<std::shared_ptr<Input>> &inputs,
+                                                              const std::vector<std::shared_ptr<Output>> &outputs)
+{
+    kleo_assert(canSignAndEncryptInOnePass());
+    kleo_assert(!d->resolvingInProgress);
+
+    kleo_assert(!inputs.empty());
+    kleo_assert(outputs.size() == inputs.size());
+
+    std::vector<std::shared_ptr<Task>> tasks;
+    tasks.reserve(inputs.size());
+
+    kleo_assert(!d->signers.empty());
+    kleo_assert(std::none_of(d->signers.cbegin(), d->signers.cend(), std::mem_fn(&Key::isNull)));
+    kleo_assert(!d->recipients.empty());
+
+    for (unsigned int i = 0, end = inputs.size(); i < end; ++i) {
+        const std::shared_ptr<SignEncryptEMailTask> task(new SignEncryptEMailTask);
+
+        task->setInput(inputs[i]);
+        task->setOutput(outputs[i]);
+        task->setSigners(d->signers);
+        task->setRecipients(d->recipients);
+
+        tasks.push_back(task);
+    }
+
+    // append to runnable stack
+    d->runnable.insert(d->runnable.end(), tasks.begin(), tasks.end());
+
+    // the same as for encryption
+    d->startEncryption();
+}
+
 void NewSignEncryptEMailController::Private::startSigning()
 {
     std::shared_ptr<TaskCollection> coll(new TaskCollection);
@@ -77,6 +77,10 @@ public:
 
     void startEncryption(const std::vector<std::shared_ptr<Kleo::Input>> &inputs, const std::vector<std::shared_ptr<Kleo::Output>> &outputs);
 
+    // Signing and encryption in one pass is only supported for OpenPGP
+    bool canSignAndEncryptInOnePass() const;
+    void startSigningAndEncryption(const std::vector<std::shared_ptr<Kleo::Input>> &inputs, const std::vector<std::shared_ptr<Kleo::Output>> &outputs);
+
 public Q_SLOTS:
     void cancel();
 
@@ -11,6 +11,7 @@
 
 #include "signemailtask.h"
 
+#include <utils/compressedauditlogentry.h>
 #include <utils/input.h>
 #include <utils/kleo_assert.h>
 #include <utils/output.h>
@@ -42,7 +43,7 @@ namespace
 class SignEMailResult : public Task::Result
 {
     const SigningResult m_result;
-    const AuditLogEntry m_auditLog;
+    const CompressedAuditLogEntry m_auditLog;
 
 public:
     explicit SignEMailResult(const SigningResult &r, const AuditLogEntry &auditLog)
@@ -58,6 +59,7 @@ public:
     QString errorString() const override;
     VisualCode code() const override;
     AuditLogEntry auditLog() const override;
+    bool hasAuditLog() const override;
 };
 
 QString makeResultString(const SigningResult &res)
@@ -283,7 +285,12 @@ Task::Result::VisualCode SignEMailResult::code() const
 
 AuditLogEntry SignEMailResult::auditLog() const
 {
-    return m_auditLog;
+    return m_auditLog.entry();
+}
+
+bool SignEMailResult::hasAuditLog() const
+{
+    return m_auditLog.isAvailable();
 }
 
 #include "moc_signemailtask.cpp"
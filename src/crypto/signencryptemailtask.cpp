@@ -0,0 +1,259 @@
+/* -*- mode: c++; c-basic-offset:4 -*-
+    crypto/signencryptemailtask.cpp
+
+    This file is part of Kleopatra, the KDE keymanager
+    SPDX-FileCopyrightText: 2024 g10 Code GmbH
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <config-kleopatra.h>
+
+#include "signencryptemailtask.h"
+
+#include <utils/compressedauditlogentry.h>
+#include <utils/input.h>
+#include <utils/kleo_assert.h>
+#include <utils/output.h>
+
+#include <Libkleo/AuditLogEntry>
+#include <Libkleo/Formatting>
+
+#include <QGpgME/Protocol>
+#include <QGpgME/SignEncryptJob>
+
+#include <gpgme++/context.h>
+#include <gpgme++/encryptionresult.h>
+#include <gpgme++/key.h>
+#include <gpgme++/signingresult.h>
+
+#include <KLocalizedString>
+
+#include <QPointer>
+
+#include <algorithm>
+#include <functional>
+
+using namespace Kleo;
+using namespace Kleo::Crypto;
+using namespace GpgME;
+
+namespace
+{
+
+class SignEncryptEMailResult : public Task::Result
+{
+    const SigningResult m_signingResult;
+    const EncryptionResult m_encryptionResult;
+    const CompressedAuditLogEntry m_auditLog;
+
+public:
+    SignEncryptEMailResult(const SigningResult &sr, const EncryptionResult &er, const AuditLogEntry &auditLog)
+        : Task::Result()
+        , m_signingResult(sr)
+        , m_encryptionResult(er)
+        , m_auditLog(auditLog)
+    {
+    }
+
+    QString overview() const override;
+    QString details() const override;
+    GpgME::Error error() const override;
+    QString errorString() const override;
+    VisualCode code() const override;
+    AuditLogEntry auditLog() const override;
+    bool hasAuditLog() const override;
+};
+
+QString makeResultString(const SigningResult &sr, const EncryptionResult &er)
+{
+    const Error err = sr.error().code() ? sr.error() : er.error();
+
+    if (err.isCanceled()) {
+        return i18n("Signing and encryption canceled.");
+    }
+
+    if (sr.error().code()) {
+        return i18n("Signing failed: %1", Formatting::errorAsString(sr.error()).toHtmlEscaped());
+    }
+
+    if (er.error().code()) {
+        return i18n("Encryption failed: %1", Formatting::errorAsString(er.error()).toHtmlEscaped());
+    }
+
+    return i18n("Signing and encryption succeeded.");
+}
+}
+
+class SignEncryptEMailTask::Private
+{
+    friend class ::Kleo::Crypto::SignEncryptEMailTask;
+    SignEncryptEMailTask *const q;
+
+public:
+    explicit Private(SignEncryptEMailTask *qq);
+
+private:
+    std::unique_ptr<QGpgME::SignEncryptJob> createJob(GpgME::Protocol proto);
+
+private:
+    void slotResult(const SigningResult &, const EncryptionResult &);
+
+private:
+    std::shared_ptr<Input> input;
+    std::shared_ptr<Output> output;
+    std::vector<Key> signers;
+    std::vector<Key> recipients;
+
+    QPointer<QGpgME::SignEncryptJob> job;
+};
+
+SignEncryptEMailTask::Private::Private(SignEncryptEMailTask *qq)
+    : q(qq)
+{
+}
+
+SignEncryptEMailTask::SignEncryptEMailTask(QObject *p)
+    : Task(p)
+    , d(new Private(this))
+{
+}
+
+SignEncryptEMailTask::~SignEncryptEMailTask()
+{
+}
+
+void SignEncryptEMailTask::setInput(const std::shared_ptr<Input> &input)
+{
+    kleo_assert(!d->job);
+    kleo_assert(input);
+    d->input = input;
+}
+
+void SignEncryptEMailTask::setOutput(const std::shared_ptr<Output> &output)
+{
+    kleo_assert(!d->job);
+    kleo_assert(output);
+    d->output = output;
+}
+
+void SignEncryptEMailTask::setSigners(const std::vector<Key> &signers)
+{
+    kleo_assert(!d->job);
+    kleo_assert(!signers.empty());
+    kleo_assert(std::none_of(signers.cbegin(), signers.cend(), std::mem_fn(&Key::isNull)));
+    d->signers = signers;
+}
+
+void SignEncryptEMailTask::setRecipients(const std::vector<Key> &recipients)
+{
+    kleo_assert(!d->job);
+    kleo_assert(!recipients.empty());
+    d->recipients = recipients;
+}
+
+Protocol SignEncryptEMailTask::protocol() const
+{
+    kleo_assert(!d->recipients.empty());
+    return d->recipients.front().protocol();
+}
+
+QString SignEncryptEMailTask::label() const
+{
+    return d->input ? d->input->label() : QString();
+}
+
+unsigned long long SignEncryptEMailTask::inputSize() const
+{
+    return d->input ? d->input->size() : 0;
+}
+
+void SignEncryptEMailTask::doStart()
+{
+    kleo_assert(!d->job);
+    kleo_assert(d->input);
+    kleo_assert(d->output);
+    kleo_assert(!d->signers.empty());
+    kleo_assert(!d->recipients.empty());
+    kleo_assert(protocol() == OpenPGP);
+
+    std::unique_ptr<QGpgME::SignEncryptJob> job = d->createJob(protocol());
+    kleo_assert(job.get());
+
+    job->start(d->signers, d->recipients, d->input->ioDevice(), d->output->ioDevice(), Context::AlwaysTrust);
+
+    d->job = job.release();
+}
+
+void SignEncryptEMailTask::cancel()
+{
+    if (d->job) {
+        d->job->slotCancel();
+    }
+}
+
+std::unique_ptr<QGpgME::SignEncryptJob> SignEncryptEMailTask::Private::createJob(GpgME::Protocol proto)
+{
+    // gpgsm cannot sign and encrypt in one operation
+    kleo_assert(proto == OpenPGP);
+    const QGpgME::Protocol *const backend = QGpgME::openpgp();
+    kleo_assert(backend);
+    std::unique_ptr<QGpgME::SignEncryptJob> signEncryptJob(backend->signEncryptJob(/*armor=*/!output->binaryOpt(), /*textmode=*/false));
+    kleo_assert(signEncryptJob.get());
+    connect(signEncryptJob.get(), &QGpgME::Job::jobProgress, q, &SignEncryptEMailTask::setProgress);
+    connect(signEncryptJob.get(), &QGpgME::SignEncryptJob::result, q, [this](const SigningResult &signingResult, const EncryptionResult &encryptionResult) {
+        slotResult(signingResult, encryptionResult);
+    });
+    return signEncryptJob;
+}
+
+void SignEncryptEMailTask::Private::slotResult(const SigningResult &signingResult, const EncryptionResult &encryptionResult)
+{
+    const auto *const job = qobject_cast<const QGpgME::Job *>(q->sender());
+    if (signingResult.error().code() || encryptionResult.error().code()) {
+        output->cancel();
+    } else {
+        output->finalize();
+    }
+    q->emitResult(std::shared_ptr<Result>(new SignEncryptEMailResult(signingResult, encryptionResult, AuditLogEntry::fromJob(job))));
+}
+
+QString SignEncryptEMailResult::overview() const
+{
+    return makeOverview(makeResultString(m_signingResult, m_encryptionResult));
+}
+
+QString SignEncryptEMailResult::details() const
+{
+    return QString();
+}
+
+GpgME::Error SignEncryptEMailResult::error() const
+{
+    return m_signingResult.error().code() ? m_signingResult.error() : m_encryptionResult.error();
+}
+
+QString SignEncryptEMailResult::errorString() const
+{
+    return hasError() ? makeResultString(m_signingResult, m_encryptionResult) : QString();
+}
+
+Task::Result::VisualCode SignEncryptEMailResult::code() const
+{
+    if (m_signingResult.error().isCanceled() || m_encryptionResult.error().isCanceled()) {
+        return Warning;
+    }
+    return error().code() ? NeutralError : NeutralSuccess;
+}
+
+AuditLogEntry SignEncryptEMailResult::auditLog() const
+{
+    return m_auditLog.entry();
+}
+
+bool SignEncryptEMailResult::hasAuditLog() const
+{
+    return m_auditLog.isAvailable();
+}
+
+#include "moc_signencryptemailtask.cpp"
@@ -0,0 +1,66 @@
+/* -*- mode: c++; c-basic-offset:4 -*-
+    crypto/signencryptemailtask.h
+
+    This file is part of Kleopatra, the KDE keymanager
+    SPDX-FileCopyrightText: 2024 g10 Code GmbH
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <crypto/task.h>
+
+#include <gpgme++/global.h>
+
+#include <memory>
+#include <vector>
+
+namespace GpgME
+{
+class Key;
+}
+
+namespace Kleo
+{
+class Input;
+class Output;
+}
+
+namespace Kleo
+{
+namespace Crypto
+{
+
+/**
+ * Signs and encrypts an email in a single backend operation, i.e. the data
+ * is passed to the backend only once. Only supported for OpenPGP.
+ */
+class SignEncryptEMailTask : public Task
+{
+    Q_OBJECT
+public:
+    explicit SignEncryptEMailTask(QObject *parent = nullptr);
+    ~SignEncryptEMailTask() override;
+
+    void setInput(const std::shared_ptr<Input> &input);
+    void setOutput(const std::shared_ptr<Output> &output);
+    void setSigners(const std::vector<GpgME::Key> &signers);
+    void setRecipients(const std::vector<GpgME::Key> &recipients);
+
+    GpgME::Protocol protocol() const override;
+
+    void cancel() override;
+    QString label() const override;
+
+private:
+    void doStart() override;
+    unsigned long long inputSize() const override;
+
+private:
+    class Private;
+    const std::unique_ptr<Private> d;
+};
+
+}
+}
@@ -18,6 +18,7 @@
 
 #include "crypto/gui/signencryptfileswizard.h"
 #include "crypto/taskcollection.h"
+#include "crypto/taskrunner.h"
 
 #include "fileoperationspreferences.h"
 
@@ -70,28 +71,29 @@ private:
 
     void schedule();
     std::shared_ptr<SignEncryptTask> takeRunnable(GpgME::Protocol proto);
+    unsigned int numberOfRunningTasks(GpgME::Protocol proto) const;
 
     static void assertValidOperation(unsigned int);
     static QString titleForOperation(unsigned int op);
 
 private:
-    std::vector<std::shared_ptr<SignEncryptTask>> runnable, completed;
-    std::shared_ptr<SignEncryptTask> cms, openpgp;
+    std::vector<std::shared_ptr<SignEncryptTask>> runnable, running, completed;
     QPointer<SignEncryptFilesWizard> wizard;
     QStringList files;
     unsigned int operation;
     Protocol protocol;
+    unsigned int maxConcurrentTasks;
 };
 
 SignEncryptFilesController::Private::Private(SignEncryptFilesController *qq)
     : q(qq)
     , runnable()
-    , cms()
-    , openpgp()
+    , running()
     , wizard()
     , files()
     , operation(SignAllowed | EncryptAllowed | ArchiveAllowed)
     , protocol(UnknownProtocol)
+    , maxConcurrentTasks(TaskRunner::defaultMaximumConcurrentTasks())
 {
 }
 
@@ -708,24 +710,32 @@ void SignEncryptFilesController::Private::slotWizardOperationPrepared()
 
 void SignEncryptFilesController::Private::schedule()
 {
-    if (!cms)
-        if (const std::shared_ptr<SignEncryptTask> t = takeRunnable(CMS)) {
-            t->start();
-            cms = t;
-        }
-
-    if (!openpgp)
-        if (const std::shared_ptr<SignEncryptTask> t = takeRunnable(OpenPGP)) {
+    // each gpg/gpgsm process uses a single core, so keep up to
+    // maxConcurrentTasks tasks per protocol in flight
+    for (const Protocol proto : {CMS, OpenPGP}) {
+        while (numberOfRunningTasks(proto) < maxConcurrentTasks) {
+            const std::shared_ptr<SignEncryptTask> t = takeRunnable(proto);
+            if (!t) {
+                break;
+            }
+            running.push_back(t);
             t->start();
-            openpgp = t;
         }
+    }
 
-    if (!cms && !openpgp) {
+    if (running.empty()) {
         kleo_assert(runnable.empty());
         q->emitDoneOrError();
     }
 }
 
+unsigned int SignEncryptFilesController::Private::numberOfRunningTasks(GpgME::Protocol proto) const
+{
+    return std::count_if(running.cbegin(), running.cend(), [proto](const std::shared_ptr<SignEncryptTask> &task) {
+        return task->protocol() == proto;
+    });
+}
+
 std::shared_ptr<SignEncryptTask> SignEncryptFilesController::Private::takeRunnable(GpgME::Protocol proto)
 {
     const auto it = std::find_if(runnable.begin(), runnable.end(), [proto](const std::shared_ptr<Task> &task) {
@@ -750,12 +760,12 @@ void SignEncryptFilesController::doTaskDone(const Task *task, const std::shared_
     // might not yet have executed. Therefore, we push completed tasks
     // into a burial container
 
-    if (task == d->cms.get()) {
-        d->completed.push_back(d->cms);
-        d->cms.reset();
-    } else if (task == d->openpgp.get()) {
-        d->completed.push_back(d->openpgp);
-        d->openpgp.reset();
+    const auto it = std::find_if(d->running.begin(), d->running.end(), [task](const std::shared_ptr<SignEncryptTask> &t) {
+        return t.get() == task;
+    });
+    if (it != d->running.end()) {
+        d->completed.push_back(*it);
+        d->running.erase(it);
     }
 
     QTimer::singleShot(0, this, SLOT(schedule()));
@@ -781,11 +791,10 @@ void SignEncryptFilesController::Private::cancelAllTasks()
     runnable.clear();
 
     // a cancel() will result in a call to
-    if (cms) {
-        cms->cancel();
-    }
-    if (openpgp) {
-        openpgp->cancel();
+    // doTaskDone(); iterate over a copy because of this
+    const auto runningTasks = running;
+    for (const auto &task : runningTasks) {
+        task->cancel();
     }
 }
 
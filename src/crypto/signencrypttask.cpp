@@ -11,6 +11,7 @@
 
 #include "signencrypttask.h"
 
+#include <utils/compressedauditlogentry.h>
 #include <utils/gpgme-compat.h>
 #include <utils/input.h>
 #include <utils/kleo_assert.h>
@@ -86,7 +87,11 @@ public:
     }
     AuditLogEntry auditLog() const override
     {
-        return m_auditLog;
+        return m_auditLog.entry();
+    }
+    bool hasAuditLog() const override
+    {
+        return m_auditLog.isAvailable();
     }
 
 private:
@@ -96,7 +101,7 @@ private:
     const QString m_errString;
     const QString m_inputLabel;
     const QString m_outputLabel;
-    const AuditLogEntry m_auditLog;
+    const CompressedAuditLogEntry m_auditLog;
 };
 
 namespace
@@ -160,6 +165,7 @@ public:
     QString errorString() const override;
     VisualCode code() const override;
     AuditLogEntry auditLog() const override;
+    bool hasAuditLog() const override;
 
 private:
     const SigningResult m_sresult;
@@ -167,7 +173,7 @@ private:
     const LabelAndError m_input;
     const LabelAndError m_output;
     const bool m_outputCreated;
-    const AuditLogEntry m_auditLog;
+    const CompressedAuditLogEntry m_auditLog;
 };
 
 static QString makeSigningOverview(const Error &err)
@@ -897,6 +903,7 @@ void SignEncryptTask::Private::slotResult(const QGpgME::Job *job, const SigningR
         try {
             kleo_assert(!sresult.isNull() || !eresult.isNull());
             if (output) {
+                output->setFileSyncList(q->fileSyncList());
                 output->finalize();
             }
             outputCreated = true;
@@ -963,7 +970,12 @@ Task::Result::VisualCode SignEncryptFilesResult::code() const
 
 AuditLogEntry SignEncryptFilesResult::auditLog() const
 {
-    return m_auditLog;
+    return m_auditLog.entry();
+}
+
+bool SignEncryptFilesResult::hasAuditLog() const
+{
+    return m_auditLog.isAvailable();
 }
 
 #include "moc_signencrypttask.cpp"
@@ -0,0 +1,115 @@
+/* -*- mode: c++; c-basic-offset:4 -*-
+    crypto/signerkeyresolver.cpp
+
+    This file is part of Kleopatra, the KDE keymanager
+    SPDX-FileCopyrightText: 2024 g10 Code GmbH
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <config-kleopatra.h>
+
+#include "signerkeyresolver.h"
+
+#include <Libkleo/KeyCache>
+
+#include <gpgme++/context.h>
+#include <gpgme++/keylistresult.h>
+#include <gpgme++/verificationresult.h>
+
+#include <algorithm>
+#include <cctype>
+#include <memory>
+
+#include "kleopatra_debug.h"
+
+using namespace Kleo;
+using namespace Kleo::Crypto;
+using namespace GpgME;
+
+namespace
+{
+static std::string normalizedFingerprint(const char *fingerprint)
+{
+    std::string result = fingerprint ? fingerprint : "";
+    std::transform(result.begin(), result.end(), result.begin(), [](unsigned char c) {
+        return std::toupper(c);
+    });
+    return result;
+}
+}
+
+std::vector<Key> SignerKeyResolver::resolve(const VerificationResult &result, Protocol protocol)
+{
+    const auto signatures = result.signatures();
+    std::vector<Key> keys(signatures.size());
+
+    const auto cache = KeyCache::instance();
+    std::vector<std::string> missing;
+    for (std::size_t i = 0; i < signatures.size(); ++i) {
+        const Signature &sig = signatures[i];
+        // the key cache is checked every time because the user may have imported the certificate in the meantime
+        keys[i] = cache->findSigner(sig);
+        if (!keys[i].isNull()) {
+            continue;
+        }
+        const auto fingerprint = normalizedFingerprint(sig.fingerprint());
+        if (!fingerprint.empty() && !m_listedKeys.contains({protocol, fingerprint})
+            && std::find(missing.begin(), missing.end(), fingerprint) == missing.end()) {
+            missing.push_back(fingerprint);
+        }
+    }
+    if (!missing.empty()) {
+        listKeys(missing, protocol);
+    }
+
+    for (std::size_t i = 0; i < signatures.size(); ++i) {
+        if (keys[i].isNull()) {
+            const auto it = m_listedKeys.find({protocol, normalizedFingerprint(signatures[i].fingerprint())});
+            if (it != m_listedKeys.end()) {
+                keys[i] = it->second;
+            }
+        }
+    }
+    return keys;
+}
+
+void SignerKeyResolver::listKeys(const std::vector<std::string> &fingerprints, Protocol protocol)
+{
+    // remember the unknown signers, too
+    for (const auto &fingerprint : fingerprints) {
+        m_listedKeys[{protocol, fingerprint}] = Key{};
+    }
+
+    const std::unique_ptr<Context> ctx{Context::createForProtocol(protocol)};
+    if (!ctx) {
+        return;
+    }
+    ctx->setKeyListMode(KeyListMode::Local | KeyListMode::Validate);
+
+    std::vector<const char *> patterns;
+    patterns.reserve(fingerprints.size() + 1);
+    for (const auto &fingerprint : fingerprints) {
+        patterns.push_back(fingerprint.c_str());
+    }
+    patterns.push_back(nullptr);
+
+    Error err = ctx->startKeyListing(patterns.data());
+    while (!err) {
+        const Key key = ctx->nextKey(err);
+        if (err || key.isNull()) {
+            break;
+        }
+        // a signature may have been made with a subkey
+        for (const auto &subkey : key.subkeys()) {
+            const auto it = m_listedKeys.find({protocol, normalizedFingerprint(subkey.fingerprint())});
+            if (it != m_listedKeys.end()) {
+                it->second = key;
+            }
+        }
+    }
+    const KeyListResult listResult = ctx->endKeyListing();
+    if (listResult.error() && !listResult.error().isCanceled()) {
+        qCDebug(KLEOPATRA_LOG) << __func__ << "Listing the signer certificates failed:" << listResult.error();
+    }
+}
@@ -0,0 +1,58 @@
+/* -*- mode: c++; c-basic-offset:4 -*-
+    crypto/signerkeyresolver.h
+
+    This file is part of Kleopatra, the KDE keymanager
+    SPDX-FileCopyrightText: 2024 g10 Code GmbH
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <gpgme++/global.h>
+#include <gpgme++/key.h>
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace GpgME
+{
+class VerificationResult;
+}
+
+namespace Kleo
+{
+namespace Crypto
+{
+
+/**
+ * Resolves the certificates of the signers of verification results.
+ *
+ * The certificates are looked up in the key cache first. The certificates
+ * that are not found there are listed from the backend with a single key
+ * listing for all missing signers of a verification result. The outcome of
+ * the backend listings (including unknown signers) is remembered, so that a
+ * resolver shared by all tasks of a task collection asks the backend at most
+ * once for each signer.
+ */
+class SignerKeyResolver
+{
+public:
+    /**
+     * Returns the certificates of the signers of @p result in the order of
+     * the signatures. Unknown signers are represented by null keys.
+     */
+    std::vector<GpgME::Key> resolve(const GpgME::VerificationResult &result, GpgME::Protocol protocol);
+
+private:
+    void listKeys(const std::vector<std::string> &fingerprints, GpgME::Protocol protocol);
+
+private:
+    // the certificates listed from the backend by protocol and signature fingerprint
+    std::map<std::pair<GpgME::Protocol, std::string>, GpgME::Key> m_listedKeys;
+};
+
+}
+}
@@ -65,6 +65,10 @@ public:
     {
         return AuditLogEntry();
     }
+    bool hasAuditLog() const override
+    {
+        return false;
+    }
 
 private:
     const GpgME::Error m_error;
@@ -85,6 +89,7 @@ private:
     int m_totalProgress;
     bool m_asciiArmor;
     int m_id;
+    std::shared_ptr<FileSyncList> m_fileSyncList;
 };
 
 namespace
@@ -121,6 +126,16 @@ bool Task::asciiArmor() const
     return d->m_asciiArmor;
 }
 
+void Task::setFileSyncList(const std::shared_ptr<FileSyncList> &list)
+{
+    d->m_fileSyncList = list;
+}
+
+std::shared_ptr<FileSyncList> Task::fileSyncList() const
+{
+    return d->m_fileSyncList;
+}
+
 std::shared_ptr<Task> Task::makeErrorTask(const GpgME::Error &error, const QString &details, const QString &label)
 {
     const std::shared_ptr<SimpleTask> t(new SimpleTask(label));
@@ -21,6 +21,7 @@
 namespace Kleo
 {
 class AuditLogEntry;
+class FileSyncList;
 }
 
 namespace Kleo
@@ -40,6 +41,13 @@ public:
     void setAsciiArmor(bool armor);
     bool asciiArmor() const;
 
+    /**
+     * Sets the list the files written by the task are added to if they are
+     * flushed to disk after all tasks have finished. Set by TaskCollection.
+     */
+    void setFileSyncList(const std::shared_ptr<FileSyncList> &list);
+    std::shared_ptr<FileSyncList> fileSyncList() const;
+
     virtual GpgME::Protocol protocol() const = 0;
 
     void start();
@@ -121,6 +129,8 @@ public:
     virtual QString errorString() const = 0;
     virtual VisualCode code() const = 0;
     virtual AuditLogEntry auditLog() const = 0;
+    // returns true if auditLog() can be shown; cheaper than calling auditLog()
+    virtual bool hasAuditLog() const = 0;
     virtual QPointer<Task> parentTask() const
     {
         return QPointer<Task>();
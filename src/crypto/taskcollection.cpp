@@ -16,6 +16,9 @@
 
 #include "kleopatra_debug.h"
 #include "task.h"
+#include "taskprogressaggregator.h"
+
+#include <utils/output.h>
 
 #include <Libkleo/GnuPG>
 
@@ -29,6 +32,12 @@
 using namespace Kleo;
 using namespace Kleo::Crypto;
 
+namespace
+{
+// the progress bars don't need to be repainted more often
+static const int maxProgressUpdatesPerSecond = 20;
+}
+
 class TaskCollection::Private
 {
     TaskCollection *const q;
@@ -36,29 +45,33 @@ class TaskCollection::Private
 public:
     explicit Private(TaskCollection *qq);
 
-    void taskProgress();
+    void taskProgress(int id, int processed, int total);
     void taskResult(const std::shared_ptr<const Task::Result> &);
     void taskStarted();
     void calculateAndEmitProgress();
 
     std::map<int, std::shared_ptr<Task>> m_tasks;
-    mutable quint64 m_totalProgress;
-    mutable quint64 m_progress;
+    TaskProgressAggregator m_progressAggregator;
+    RateLimiter m_progressRateLimiter;
     unsigned int m_nCompleted;
     unsigned int m_nErrors;
     bool m_errorOccurred;
     bool m_doneEmitted;
+    // the files written by the tasks of this collection
+    const std::shared_ptr<FileSyncList> m_fileSyncList = std::make_shared<FileSyncList>();
 };
 
 TaskCollection::Private::Private(TaskCollection *qq)
     : q(qq)
-    , m_totalProgress(0)
-    , m_progress(0)
+    , m_progressRateLimiter(maxProgressUpdatesPerSecond)
     , m_nCompleted(0)
     , m_nErrors(0)
     , m_errorOccurred(false)
     , m_doneEmitted(false)
 {
+    QObject::connect(&m_progressRateLimiter, &RateLimiter::triggered, q, [this]() {
+        calculateAndEmitProgress();
+    });
 }
 
 int TaskCollection::numberOfCompletedTasks() const
@@ -77,9 +90,10 @@ bool TaskCollection::allTasksCompleted() const
     return d->m_nCompleted == d->m_tasks.size();
 }
 
-void TaskCollection::Private::taskProgress()
+void TaskCollection::Private::taskProgress(int id, int processed, int total)
 {
-    calculateAndEmitProgress();
+    m_progressAggregator.setProgress(id, std::max(processed, 0), std::max(total, 0));
+    m_progressRateLimiter.request();
 }
 
 void TaskCollection::Private::taskResult(const std::shared_ptr<const Task::Result> &result)
@@ -91,9 +105,15 @@ void TaskCollection::Private::taskResult(const std::shared_ptr<const Task::Resul
         m_errorOccurred = true;
         ++m_nErrors;
     }
-    calculateAndEmitProgress();
+    m_progressRateLimiter.request();
+    if (q->allTasksCompleted()) {
+        // don't keep the final progress back
+        m_progressRateLimiter.flush();
+    }
     Q_EMIT q->result(result);
     if (!m_doneEmitted && q->allTasksCompleted()) {
+        // flush the written files to disk if this is deferred until the end
+        m_fileSyncList->syncFiles();
         Q_EMIT q->done();
         m_doneEmitted = true;
     }
@@ -105,7 +125,8 @@ void TaskCollection::Private::taskStarted()
     Q_ASSERT(task);
     Q_ASSERT(m_tasks.find(task->id()) != m_tasks.end());
     Q_EMIT q->started(m_tasks[task->id()]);
-    calculateAndEmitProgress(); // start Knight-Rider-Mode right away (gpgsm doesn't report _any_ progress).
+    m_progressAggregator.setProgress(task->id(), std::max(task->currentProgress(), 0), std::max(task->totalProgress(), 0));
+    m_progressRateLimiter.request(); // start Knight-Rider-Mode right away (gpgsm doesn't report _any_ progress).
     if (m_doneEmitted) {
         // We are not done anymore, one task restarted.
         m_nCompleted--;
@@ -116,9 +137,6 @@ void TaskCollection::Private::taskStarted()
 
 void TaskCollection::Private::calculateAndEmitProgress()
 {
-    quint64 total = 0;
-    quint64 processed = 0;
-
     static bool haveWorkingProgress = engineIsVersion(2, 1, 15);
     if (!haveWorkingProgress) {
         // GnuPG before 2.1.15 would overflow on progress values > max int.
@@ -133,26 +151,18 @@ void TaskCollection::Private::calculateAndEmitProgress()
         return;
     }
 
-    bool unknowable = false;
-    for (auto it = m_tasks.begin(), end = m_tasks.end(); it != end; ++it) {
-        // Sum up progress and totals
-        const std::shared_ptr<Task> &i = it->second;
-        Q_ASSERT(i);
-        if (!i->totalProgress()) {
-            // There still might be jobs for which we don't know the progress.
-            qCDebug(KLEOPATRA_LOG) << "Task: " << i->label() << " has no total progress set. ";
-            unknowable = true;
-            break;
-        }
-        processed += i->currentProgress();
-        total += i->totalProgress();
+    // the sums are kept up to date by taskProgress() and taskStarted()
+    const bool unknowable = !m_progressAggregator.totalIsKnown();
+    if (unknowable) {
+        // There still might be jobs for which we don't know the progress.
+        qCDebug(KLEOPATRA_LOG) << "Not all tasks have a total progress set.";
     }
+    const quint64 processed = m_progressAggregator.processed();
+    const quint64 total = m_progressAggregator.total();
 
-    m_totalProgress = total;
-    m_progress = processed;
     if (!unknowable && processed && total >= processed) {
         // Scale down to avoid range issues.
-        int scaled = 1000 * (m_progress / static_cast<double>(m_totalProgress));
+        int scaled = 1000 * (processed / static_cast<double>(total));
         qCDebug(KLEOPATRA_LOG) << "Collection Progress: " << scaled << " total: " << 1000;
         if (total == processed) {
             // This can happen when an output is finalizing, e.g. extracting an
@@ -216,8 +226,11 @@ void TaskCollection::setTasks(const std::vector<std::shared_ptr<Task>> &tasks)
     for (const std::shared_ptr<Task> &i : tasks) {
         Q_ASSERT(i);
         d->m_tasks[i->id()] = i;
-        connect(i.get(), &Task::progress, this, [this]() {
-            d->taskProgress();
+        i->setFileSyncList(d->m_fileSyncList);
+        d->m_progressAggregator.addTask(i->id());
+        d->m_progressAggregator.setProgress(i->id(), std::max(i->currentProgress(), 0), std::max(i->totalProgress(), 0));
+        connect(i.get(), &Task::progress, this, [this, id = i->id()](int processed, int total) {
+            d->taskProgress(id, processed, total);
         });
         connect(i.get(),
                 SIGNAL(result(std::shared_ptr<const Kleo::Crypto::Task::Result>)),
@@ -0,0 +1,96 @@
+/* -*- mode: c++; c-basic-offset:4 -*-
+    crypto/taskprogressaggregator.cpp
+
+    This file is part of Kleopatra, the KDE keymanager
+    SPDX-FileCopyrightText: 2024 g10 Code GmbH
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <config-kleopatra.h>
+
+#include "taskprogressaggregator.h"
+
+#include <algorithm>
+
+using namespace Kleo;
+using namespace Kleo::Crypto;
+
+void TaskProgressAggregator::addTask(int id)
+{
+    const auto [it, inserted] = m_tasks.try_emplace(id);
+    if (inserted) {
+        m_numTasksWithoutTotal++;
+    } else {
+        setProgress(id, 0, 0);
+    }
+}
+
+void TaskProgressAggregator::setProgress(int id, quint64 processed, quint64 total)
+{
+    const auto it = m_tasks.find(id);
+    if (it == m_tasks.end()) {
+        return;
+    }
+    Progress &progress = it->second;
+    if (!progress.total && total) {
+        m_numTasksWithoutTotal--;
+    } else if (progress.total && !total) {
+        m_numTasksWithoutTotal++;
+    }
+    m_processed = m_processed - progress.processed + processed;
+    m_total = m_total - progress.total + total;
+    progress = {processed, total};
+}
+
+quint64 TaskProgressAggregator::processed() const
+{
+    return m_processed;
+}
+
+quint64 TaskProgressAggregator::total() const
+{
+    return m_total;
+}
+
+bool TaskProgressAggregator::totalIsKnown() const
+{
+    return m_numTasksWithoutTotal == 0;
+}
+
+RateLimiter::RateLimiter(int maxPerSecond, QObject *parent)
+    : QObject{parent}
+{
+    m_timer.setSingleShot(true);
+    m_timer.setInterval(1000 / std::max(maxPerSecond, 1));
+    connect(&m_timer, &QTimer::timeout, this, [this]() {
+        if (m_pending) {
+            trigger();
+        }
+    });
+}
+
+void RateLimiter::request()
+{
+    if (m_timer.isActive()) {
+        m_pending = true;
+    } else {
+        trigger();
+    }
+}
+
+void RateLimiter::flush()
+{
+    if (m_pending) {
+        trigger();
+    }
+}
+
+void RateLimiter::trigger()
+{
+    m_pending = false;
+    m_timer.start();
+    Q_EMIT triggered();
+}
+
+#include "moc_taskprogressaggregator.cpp"
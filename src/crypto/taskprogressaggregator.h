@@ -0,0 +1,89 @@
+/* -*- mode: c++; c-basic-offset:4 -*-
+    crypto/taskprogressaggregator.h
+
+    This file is part of Kleopatra, the KDE keymanager
+    SPDX-FileCopyrightText: 2024 g10 Code GmbH
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QObject>
+#include <QTimer>
+
+#include <unordered_map>
+
+namespace Kleo
+{
+namespace Crypto
+{
+
+/**
+ * Keeps the sum of the progress of a number of tasks. The sums are updated
+ * with the difference to the previously reported progress of a task, so that
+ * an update doesn't depend on the number of tasks.
+ */
+class TaskProgressAggregator
+{
+public:
+    /**
+     * Adds a task without progress. Adding a task twice resets its progress.
+     */
+    void addTask(int id);
+
+    /**
+     * Updates the progress of the task @p id. Does nothing for unknown tasks.
+     */
+    void setProgress(int id, quint64 processed, quint64 total);
+
+    quint64 processed() const;
+    quint64 total() const;
+
+    /**
+     * Returns true if all tasks have reported a total.
+     */
+    bool totalIsKnown() const;
+
+private:
+    struct Progress {
+        quint64 processed = 0;
+        quint64 total = 0;
+    };
+    std::unordered_map<int, Progress> m_tasks;
+    quint64 m_processed = 0;
+    quint64 m_total = 0;
+    std::size_t m_numTasksWithoutTotal = 0;
+};
+
+/**
+ * Coalesces requests, so that triggered() is emitted at most
+ * @p maxPerSecond times per second. The first request is answered
+ * immediately. Further requests are answered when the interval is over.
+ */
+class RateLimiter : public QObject
+{
+    Q_OBJECT
+public:
+    explicit RateLimiter(int maxPerSecond, QObject *parent = nullptr);
+
+    void request();
+
+    /**
+     * Emits triggered() immediately if a request is pending.
+     */
+    void flush();
+
+Q_SIGNALS:
+    void triggered();
+
+private:
+    void trigger();
+
+private:
+    QTimer m_timer;
+    bool m_pending = false;
+};
+
+}
+}
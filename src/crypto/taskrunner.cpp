@@ -0,0 +1,205 @@
+/* -*- mode: c++; c-basic-offset:4 -*-
+    crypto/taskrunner.cpp
+
+    This file is part of Kleopatra, the KDE keymanager
+    SPDX-FileCopyrightText: 2024 g10 Code GmbH
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <config-kleopatra.h>
+
+#include "taskrunner.h"
+
+#include "fileoperationspreferences.h"
+
+#include "kleopatra_debug.h"
+
+#include <QThread>
+#include <QTimer>
+
+#include <algorithm>
+#include <unordered_map>
+
+using namespace Kleo;
+using namespace Kleo::Crypto;
+
+class TaskRunner::Private
+{
+    friend class ::Kleo::Crypto::TaskRunner;
+    TaskRunner *const q;
+
+public:
+    explicit Private(TaskRunner *qq)
+        : q(qq)
+        , m_maxConcurrentTasks(defaultMaximumConcurrentTasks())
+    {
+    }
+
+private:
+    void schedule();
+    void taskResult(const Task *task, const std::shared_ptr<const Task::Result> &result);
+    void reportReadyResults();
+
+private:
+    enum State {
+        Pending,
+        Running,
+        Done,
+        Skipped,
+    };
+    struct Entry {
+        std::shared_ptr<Task> task;
+        State state = Pending;
+        std::shared_ptr<const Task::Result> result;
+    };
+    std::vector<Entry> m_entries;
+    std::unordered_map<const Task *, size_t> m_indexes;
+    std::vector<std::shared_ptr<const Task::Result>> m_results;
+    size_t m_nextToStart = 0;
+    size_t m_nextToReport = 0;
+    unsigned int m_running = 0;
+    unsigned int m_maxConcurrentTasks;
+    bool m_finishedEmitted = false;
+};
+
+void TaskRunner::Private::schedule()
+{
+    while (m_running < m_maxConcurrentTasks && m_nextToStart < m_entries.size()) {
+        Entry &entry = m_entries[m_nextToStart++];
+        if (entry.state != Pending) {
+            continue;
+        }
+        entry.state = Running;
+        ++m_running;
+        // keep the task alive while it is started
+        const std::shared_ptr<Task> task = entry.task;
+        task->start();
+    }
+    reportReadyResults();
+}
+
+void TaskRunner::Private::taskResult(const Task *task, const std::shared_ptr<const Task::Result> &result)
+{
+    const auto it = m_indexes.find(task);
+    if (it == m_indexes.end()) {
+        return;
+    }
+    Entry &entry = m_entries[it->second];
+    if (entry.state != Running) {
+        qCDebug(KLEOPATRA_LOG) << __func__ << "Ignoring result of task" << task->label() << "which isn't running";
+        return;
+    }
+    entry.state = Done;
+    entry.result = result;
+    --m_running;
+
+    reportReadyResults();
+
+    // don't start the next task from within the result emission of this task
+    QTimer::singleShot(0, q, [this]() {
+        schedule();
+    });
+}
+
+void TaskRunner::Private::reportReadyResults()
+{
+    while (m_nextToReport < m_entries.size()) {
+        Entry &entry = m_entries[m_nextToReport];
+        if (entry.state == Pending || entry.state == Running) {
+            return;
+        }
+        ++m_nextToReport;
+        if (entry.state == Done) {
+            const std::shared_ptr<const Task::Result> result = std::move(entry.result);
+            m_results.push_back(result);
+            Q_EMIT q->result(result);
+        }
+    }
+    if (m_running == 0 && m_nextToStart == m_entries.size() && !m_finishedEmitted) {
+        m_finishedEmitted = true;
+        Q_EMIT q->finished();
+    }
+}
+
+TaskRunner::TaskRunner(QObject *parent)
+    : QObject(parent)
+    , d(new Private(this))
+{
+}
+
+TaskRunner::~TaskRunner()
+{
+}
+
+// static
+unsigned int TaskRunner::defaultMaximumConcurrentTasks()
+{
+    const int configured = FileOperationsPreferences().maxConcurrentTasks();
+    return configured > 0 ? configured : std::max(1, QThread::idealThreadCount());
+}
+
+void TaskRunner::setMaximumConcurrentTasks(unsigned int max)
+{
+    d->m_maxConcurrentTasks = std::max(1U, max);
+}
+
+unsigned int TaskRunner::maximumConcurrentTasks() const
+{
+    return d->m_maxConcurrentTasks;
+}
+
+void TaskRunner::setTasks(const std::vector<std::shared_ptr<Task>> &tasks)
+{
+    Q_ASSERT(d->m_entries.empty());
+    d->m_entries.reserve(tasks.size());
+    for (const std::shared_ptr<Task> &task : tasks) {
+        Q_ASSERT(task);
+        d->m_indexes[task.get()] = d->m_entries.size();
+        d->m_entries.push_back({task, Private::Pending, {}});
+        connect(task.get(), &Task::result, this, [this, t = task.get()](const std::shared_ptr<const Task::Result> &result) {
+            d->taskResult(t, result);
+        });
+    }
+}
+
+std::vector<std::shared_ptr<const Task::Result>> TaskRunner::results() const
+{
+    return d->m_results;
+}
+
+bool TaskRunner::isFinished() const
+{
+    return d->m_finishedEmitted;
+}
+
+void TaskRunner::start()
+{
+    d->schedule();
+}
+
+void TaskRunner::cancel()
+{
+    // we just drop all tasks that haven't been started yet - this will not
+    // result in signal emissions.
+    for (size_t i = d->m_nextToStart; i < d->m_entries.size(); ++i) {
+        d->m_entries[i].state = Private::Skipped;
+    }
+    d->m_nextToStart = d->m_entries.size();
+
+    // a cancel() will result in a call to taskResult(); collect the
+    // running tasks first because of this
+    std::vector<std::shared_ptr<Task>> running;
+    for (const auto &entry : d->m_entries) {
+        if (entry.state == Private::Running) {
+            running.push_back(entry.task);
+        }
+    }
+    for (const auto &task : running) {
+        task->cancel();
+    }
+
+    d->reportReadyResults();
+}
+
+#include "moc_taskrunner.cpp"
@@ -0,0 +1,80 @@
+/* -*- mode: c++; c-basic-offset:4 -*-
+    crypto/taskrunner.h
+
+    This file is part of Kleopatra, the KDE keymanager
+    SPDX-FileCopyrightText: 2024 g10 Code GmbH
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QObject>
+
+#include <crypto/task.h>
+
+#include <memory>
+#include <vector>
+
+namespace Kleo
+{
+namespace Crypto
+{
+
+/**
+ * Runs a list of tasks with a bounded number of tasks running at the same
+ * time. The results of the tasks are reported in the order in which the
+ * tasks were passed to setTasks(), regardless of the order in which the
+ * tasks finish.
+ */
+class TaskRunner : public QObject
+{
+    Q_OBJECT
+public:
+    explicit TaskRunner(QObject *parent = nullptr);
+    ~TaskRunner() override;
+
+    /**
+     * Returns the configured maximum number of concurrently running tasks,
+     * or the number of processor cores if nothing is configured.
+     */
+    static unsigned int defaultMaximumConcurrentTasks();
+
+    void setMaximumConcurrentTasks(unsigned int max);
+    unsigned int maximumConcurrentTasks() const;
+
+    void setTasks(const std::vector<std::shared_ptr<Task>> &tasks);
+
+    /**
+     * Returns the results that have been reported so far in the order of
+     * the tasks.
+     */
+    std::vector<std::shared_ptr<const Task::Result>> results() const;
+
+    bool isFinished() const;
+
+public Q_SLOTS:
+    void start();
+    /**
+     * Discards all tasks that have not been started yet and cancels the
+     * running tasks.
+     */
+    void cancel();
+
+Q_SIGNALS:
+    /**
+     * Emitted for the result of each task in the order of the tasks.
+     */
+    void result(const std::shared_ptr<const Kleo::Crypto::Task::Result> &result);
+    /**
+     * Emitted after the results of all tasks have been reported.
+     */
+    void finished();
+
+private:
+    class Private;
+    const std::unique_ptr<Private> d;
+};
+
+}
+}
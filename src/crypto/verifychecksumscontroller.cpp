@@ -11,6 +11,7 @@
 
 #include "verifychecksumscontroller.h"
 
+#include "checksumengine_p.h"
 #include "checksumsutils_p.h"
 
 #ifndef QT_NO_DIRMODEL
@@ -34,9 +35,11 @@
 #include <QProcess>
 #include <QProgressDialog>
 #include <QThread>
+#include <QThreadPool>
 
 #include <gpg-error.h>
 
+#include <atomic>
 #include <deque>
 #include <limits>
 #include <set>
@@ -102,6 +105,7 @@ public:
 Q_SIGNALS:
     void baseDirectories(const QStringList &);
     void progress(int, int, const QString &);
+    void processedBytes(quint64 processed, quint64 total);
     void status(const QString &file, Kleo::Crypto::Gui::VerifyChecksumsDialog::Status);
 
 private:
@@ -183,7 +187,14 @@ void VerifyChecksumsController::start()
 
         connect(d->dialog.data(), &VerifyChecksumsDialog::canceled, this, &VerifyChecksumsController::cancel);
         connect(d.get(), &Private::baseDirectories, d->dialog.data(), &VerifyChecksumsDialog::setBaseDirectories);
-        connect(d.get(), &Private::progress, d->dialog.data(), &VerifyChecksumsDialog::setProgress);
+        // while verifying the dialog shows the processed bytes; the progress
+        // is only forwarded for the busy indicator of the preparatory steps
+        connect(d.get(), &Private::progress, d->dialog.data(), [dialog = d->dialog.data()](int current, int total) {
+            if (total == 0) {
+                dialog->setProgress(current, total);
+            }
+        });
+        connect(d.get(), &Private::processedBytes, d->dialog.data(), &VerifyChecksumsDialog::setProcessedBytes);
         connect(d.get(), &Private::status, d->dialog.data(), &VerifyChecksumsDialog::setStatus);
 
         d->canceled = false;
@@ -210,6 +221,7 @@ struct SumFile {
     QString sumFile;
     quint64 totalSize;
     std::shared_ptr<ChecksumDefinition> checksumDefinition;
+    std::vector<ChecksumsUtils::File> files;
 };
 
 }
@@ -388,6 +400,7 @@ static std::vector<SumFile> find_sums_by_input_files(const QStringList &files,
                 sumFileName,
                 aggregate_size(it->first, files),
                 ChecksumsUtils::filename2definition(sumFileName, checksumDefinitions),
+                summedfiles,
             };
             sumfiles.push_back(sumFile);
         }
@@ -480,6 +493,28 @@ process(const SumFile &sumFile, bool *fatal, const QStringList &env, const std::
     return QString();
 }
 
+// Verifies a single file listed in @p sumFile in-process and reports its status.
+static QString process_builtin(const SumFile &sumFile,
+                               const ChecksumsUtils::File &file,
+                               QCryptographicHash::Algorithm algorithm,
+                               const std::function<bool()> &canceled,
+                               const std::function<void(qint64)> &progress,
+                               const std::function<void(const QString &, VerifyChecksumsDialog::Status)> &status)
+{
+    const QString absFilePath = sumFile.dir.absoluteFilePath(file.name);
+    QString error;
+    const QByteArray checksum = ChecksumsUtils::hash_file(absFilePath, algorithm, canceled, progress, &error);
+    if (canceled()) {
+        return QString();
+    }
+    if (checksum.isEmpty()) {
+        status(absFilePath, VerifyChecksumsDialog::Error);
+        return error;
+    }
+    status(absFilePath, checksum.compare(file.checksum, Qt::CaseInsensitive) == 0 ? VerifyChecksumsDialog::OK : VerifyChecksumsDialog::Failed);
+    return QString();
+}
+
 namespace
 {
 static QDebug operator<<(QDebug s, const SumFile &sum)
@@ -540,19 +575,72 @@ void VerifyChecksumsController::Private::run()
             // re-scale 'total' to fit into ints (wish QProgressDialog would use quint64...)
             const quint64 factor = total / std::numeric_limits<int>::max() + 1;
 
-            quint64 done = 0;
-            for (const SumFile &sumFile : sumfiles) {
-                Q_EMIT progress(done / factor, total / factor, i18n("Verifying checksums (%2) in %1", sumFile.checksumDefinition->label(), sumFile.dir.path()));
-                bool fatal = false;
-                const QString error = process(sumFile, &fatal, env, statusCb);
+            // don't flood the GUI thread with progress updates for every file
+            const quint64 granularity = std::max<quint64>(total / 1000, 1);
+            const QString verifying = i18n("Verifying checksums...");
+            std::atomic<quint64> done = 0;
+            const auto bytesCb = [&](qint64 n) {
+                const quint64 before = done.fetch_add(n);
+                if ((before + n) / granularity != before / granularity) {
+                    Q_EMIT progress((before + n) / factor, total / factor, verifying);
+                    Q_EMIT processedBytes(before + n, total);
+                }
+            };
+
+            std::atomic<bool> fatal = false;
+            const std::function<bool()> canceledCb = [this, &fatal]() {
+                return canceled || fatal;
+            };
+
+            QMutex errorsMutex;
+            const auto addError = [&](const QString &error) {
                 if (!error.isEmpty()) {
+                    const QMutexLocker locker(&errorsMutex);
                     errors.push_back(error);
                 }
-                done += sumFile.totalSize;
-                if (fatal || canceled) {
+            };
+
+            Q_EMIT progress(0, total / factor, verifying);
+            Q_EMIT processedBytes(0, total);
+
+            // The files listed in sum files we can handle ourselves are
+            // verified individually; all other sum files are handed to the
+            // external program as a whole. In both cases all work items run
+            // in parallel and report the status of each file as soon as it
+            // is known.
+            QThreadPool pool;
+            pool.setMaxThreadCount(ChecksumsUtils::hashing_thread_count());
+
+            for (const SumFile &sumFile : sumfiles) {
+                if (canceledCb()) {
                     break;
                 }
+                if (const auto algorithm = ChecksumsUtils::builtin_algorithm(sumFile.checksumDefinition)) {
+                    for (const ChecksumsUtils::File &file : sumFile.files) {
+                        pool.start([&, sumFilePtr = &sumFile, filePtr = &file, algorithm = *algorithm]() {
+                            if (!canceledCb()) {
+                                addError(process_builtin(*sumFilePtr, *filePtr, algorithm, canceledCb, bytesCb, statusCb));
+                            }
+                        });
+                    }
+                } else {
+                    pool.start([&, sumFilePtr = &sumFile]() {
+                        if (canceledCb()) {
+                            return;
+                        }
+                        bool isFatal = false;
+                        addError(process(*sumFilePtr, &isFatal, env, statusCb));
+                        if (isFatal) {
+                            fatal = true;
+                        }
+                        bytesCb(sumFilePtr->totalSize);
+                    });
+                }
             }
+
+            pool.waitForDone();
+
+            Q_EMIT processedBytes(done, total);
             Q_EMIT progress(done / factor, total / factor, i18n("Done."));
         }
     }
@@ -28,6 +28,7 @@
 #include <Libkleo/GnuPG>
 #include <utils/kdpipeiodevice.h>
 #include <utils/log.h>
+#include <utils/tags.h>
 #include <utils/userinfo.h>
 
 #include <gpgme++/key.h>
@@ -225,6 +226,7 @@ public:
     std::shared_ptr<Log> log;
     std::shared_ptr<FileSystemWatcher> watcher;
     std::shared_ptr<QSettings> distroSettings;
+    bool remarksEnabled = false;
 
 public:
     void setupKeyCache()
@@ -239,10 +241,18 @@ public:
         keyCache->addFileSystemWatcher(watcher);
         keyCache->setGroupConfig(groupConfig);
         keyCache->setGroupsEnabled(Settings().groupsEnabled());
-        // always enable remarks (aka tags); in particular, this triggers a
-        // relisting of the keys with signatures and signature notations
-        // after the initial (fast) key listing
-        keyCache->enableRemarks(true);
+        // remarks (aka tags) need a relisting of the keys with signatures and
+        // signature notations after the initial (fast) key listing, which
+        // takes about as long again; remarks are only shown for certifications
+        // made with tag keys, so don't enable them before there are such keys
+        const auto enableRemarksIfNeeded = [this]() {
+            if (!remarksEnabled && !Tags::tagKeys().empty()) {
+                remarksEnabled = true;
+                keyCache->enableRemarks(true);
+            }
+        };
+        connect(keyCache.get(), &KeyCache::keyListingDone, q, enableRemarksIfNeeded);
+        connect(keyCache.get(), &KeyCache::keysMayHaveChanged, q, enableRemarksIfNeeded);
     }
 
     void setUpFilterManager()
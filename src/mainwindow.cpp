@@ -35,6 +35,7 @@
 #include "utils/filedialog.h"
 #include "utils/gui-helper.h"
 #include "utils/keyexportdraghandler.h"
+#include "utils/progressivekeylisting.h"
 #include "utils/userinfo.h"
 
 #include <Libkleo/GnuPG>
@@ -417,6 +418,7 @@ private:
         PadWidget *padWidget = nullptr;
         WelcomeWidget *welcomeWidget = nullptr;
         QStackedWidget *stackWidget = nullptr;
+        QPointer<KeyCacheOverlay> keyCacheOverlay;
         explicit UI(MainWindow *q);
     } ui;
     QAction *focusToClickSearchAction = nullptr;
@@ -435,7 +437,7 @@ MainWindow::Private::UI::UI(MainWindow *q)
     searchTab = new CertificateView{q};
     stackWidget->addWidget(searchTab);
 
-    new KeyCacheOverlay(mainWidget, q);
+    keyCacheOverlay = new KeyCacheOverlay(mainWidget, q);
 
     welcomeWidget = new WelcomeWidget{q};
     stackWidget->addWidget(welcomeWidget);
@@ -535,16 +537,22 @@ MainWindow::Private::Private(MainWindow *qq)
         keyListingDone();
     }
 
-    // delay setting the models to use the key cache so that the UI (including
-    // the "Loading certificate cache..." overlay) is shown before the
-    // blocking key cache initialization happens
-    QMetaObject::invokeMethod(
-        q,
-        [flatModel, hierarchicalModel]() {
-            flatModel->useKeyCache(true, KeyList::AllKeys);
-            hierarchicalModel->useKeyCache(true, KeyList::AllKeys);
-        },
-        Qt::QueuedConnection);
+    // fill the models progressively until the key cache has been initialized;
+    // delay this so that the UI (including the "Loading certificate cache..."
+    // overlay) is shown first
+    auto keyListing = new ProgressiveKeyListing{{flatModel, hierarchicalModel}, KeyList::AllKeys, q};
+    connect(keyListing, &ProgressiveKeyListing::firstKeysAdded, q, [this]() {
+        // the list is incomplete until the key cache has been initialized
+        if (ui.keyCacheOverlay) {
+            ui.keyCacheOverlay->showAsBanner();
+        }
+    });
+    connect(keyListing, &ProgressiveKeyListing::finished, q, [this]() {
+        if (ui.keyCacheOverlay) {
+            ui.keyCacheOverlay->hideOverlay();
+        }
+    });
+    QMetaObject::invokeMethod(keyListing, &ProgressiveKeyListing::start, Qt::QueuedConnection);
 }
 
 MainWindow::Private::~Private()
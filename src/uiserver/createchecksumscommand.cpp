@@ -63,6 +63,7 @@ int CreateChecksumsCommand::doStart()
     d->controller.reset(new CreateChecksumsController(shared_from_this()));
 
     d->controller->setAllowAddition(hasOption("allow-addition"));
+    d->controller->setIncremental(hasOption("incremental"));
 
     d->controller->setFiles(fileNames());
 
@@ -95,7 +95,12 @@ void EncryptCommand::Private::checkForErrors() const
         if (!q->senders().empty())
             throw Exception(makeError(GPG_ERR_CONFLICT), i18n("New senders added after PREP_ENCRYPT command"));
 
+        if (q->hasOption("sign") && !m->isSigning())
+            throw Exception(makeError(GPG_ERR_CONFLICT), i18n("ENCRYPT --sign requires a previous PREP_ENCRYPT --expect-sign"));
+
     } else {
+        if (q->hasOption("sign"))
+            throw Exception(makeError(GPG_ERR_CONFLICT), i18n("ENCRYPT --sign requires a previous PREP_ENCRYPT --expect-sign"));
         if (q->recipients().empty() || q->informativeRecipients())
             throw Exception(makeError(GPG_ERR_MISSING_VALUE), i18n("No recipients given, or only with --info"));
     }
@@ -159,7 +164,14 @@ void EncryptCommand::Private::slotRecipientsResolved()
             }
         }
 
-        cont->startEncryption(q->inputs(), q->outputs());
+        if (q->hasOption("sign")) {
+            // sign and encrypt in one pass instead of a separate SIGN
+            if (!cont->canSignAndEncryptInOnePass())
+                throw Exception(makeError(GPG_ERR_NOT_SUPPORTED), i18n("Signing and encrypting in one operation is only supported for OpenPGP"));
+            cont->startSigningAndEncryption(q->inputs(), q->outputs());
+        } else {
+            cont->startEncryption(q->inputs(), q->outputs());
+        }
 
         return;
 
@@ -0,0 +1,247 @@
+/* -*- mode: c++; c-basic-offset:4 -*-
+    utils/certificatefingerprints.cpp
+
+    This file is part of Kleopatra, the KDE keymanager
+    SPDX-FileCopyrightText: 2024 g10 Code GmbH
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <config-kleopatra.h>
+
+#include "certificatefingerprints.h"
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QCryptographicHash>
+#include <QList>
+
+using namespace Kleo;
+
+namespace
+{
+static const unsigned int publicKeyPacketTag = 6;
+
+static unsigned int byteAt(QByteArrayView data, qsizetype pos)
+{
+    return static_cast<unsigned char>(data[pos]);
+}
+
+static QByteArrayView trimmed(QByteArrayView line)
+{
+    while (!line.isEmpty() && (line.back() == '\r' || line.back() == ' ' || line.back() == '\t')) {
+        line.chop(1);
+    }
+    return line;
+}
+
+static bool isCertificateBeginLine(QByteArrayView line)
+{
+    return line == "-----BEGIN CERTIFICATE-----" || line == "-----BEGIN X509 CERTIFICATE-----";
+}
+
+static bool isPublicKeyBlockBeginLine(QByteArrayView line)
+{
+    return line == "-----BEGIN PGP PUBLIC KEY BLOCK-----";
+}
+
+// returns the base64-decoded content of all blocks starting with a line for
+// which isBeginLine returns true; headers and OpenPGP armor checksums are
+// skipped; blocks without end line or with invalid base64 are skipped
+template<typename BeginLinePredicate>
+static QList<QByteArray> dearmor(const QByteArray &data, BeginLinePredicate isBeginLine)
+{
+    enum State {
+        Outside,
+        Headers,
+        Body,
+    } state = Outside;
+
+    QList<QByteArray> blocks;
+    QByteArray base64;
+    const QList<QByteArray> lines = data.split('\n');
+    for (const QByteArray &rawLine : lines) {
+        const QByteArrayView line = trimmed(rawLine);
+        switch (state) {
+        case Outside:
+            if (isBeginLine(line)) {
+                state = Headers;
+                base64.clear();
+            }
+            break;
+        case Headers:
+            // headers are "Key: Value" lines; base64 doesn't contain colons
+            if (line.isEmpty() || line.contains(':')) {
+                break;
+            }
+            state = Body;
+            [[fallthrough]];
+        case Body:
+            if (isBeginLine(line)) {
+                // the previous block is missing its end line
+                base64.clear();
+                state = Headers;
+            } else if (line.startsWith("-----END ")) {
+                if (const auto decoded = QByteArray::fromBase64Encoding(base64, QByteArray::AbortOnBase64DecodingErrors)) {
+                    blocks.push_back(*decoded);
+                }
+                state = Outside;
+            } else if (line.size() == 5 && line.startsWith('=')) {
+                // CRC24 checksum of an OpenPGP armor; gpg checks it on import
+            } else {
+                base64.append(line);
+            }
+            break;
+        }
+    }
+    return blocks;
+}
+
+// checks that data consists of exactly one DER-encoded SEQUENCE (with a
+// definite length); this rejects truncated or otherwise damaged blocks
+static bool isDERSequence(QByteArrayView data)
+{
+    if (data.size() < 2 || byteAt(data, 0) != 0x30) {
+        return false;
+    }
+    const unsigned int firstLengthByte = byteAt(data, 1);
+    qsizetype headerSize = 2;
+    qsizetype length = firstLengthByte;
+    if (firstLengthByte & 0x80) {
+        const unsigned int numLengthBytes = firstLengthByte & 0x7f;
+        if (numLengthBytes == 0 || numLengthBytes > 4 || data.size() < 2 + qsizetype(numLengthBytes)) {
+            return false;
+        }
+        length = 0;
+        for (unsigned int i = 0; i < numLengthBytes; ++i) {
+            length = (length << 8) | byteAt(data, 2 + i);
+        }
+        headerSize += numLengthBytes;
+    }
+    return data.size() - headerSize == length;
+}
+
+// returns the fingerprint of the key in the body of a public key packet
+static std::string publicKeyFingerprint(QByteArrayView body)
+{
+    if (body.isEmpty()) {
+        return {};
+    }
+    QByteArray hashed;
+    hashed.reserve(5 + body.size());
+    QCryptographicHash::Algorithm algorithm;
+    switch (byteAt(body, 0)) {
+    case 4:
+        if (body.size() > 0xffff) {
+            return {};
+        }
+        hashed += char(0x99);
+        hashed += char(body.size() >> 8);
+        hashed += char(body.size() & 0xff);
+        algorithm = QCryptographicHash::Sha1;
+        break;
+    case 5:
+    case 6:
+        hashed += char(byteAt(body, 0) == 5 ? 0x9a : 0x9b);
+        hashed += char((body.size() >> 24) & 0xff);
+        hashed += char((body.size() >> 16) & 0xff);
+        hashed += char((body.size() >> 8) & 0xff);
+        hashed += char(body.size() & 0xff);
+        algorithm = QCryptographicHash::Sha256;
+        break;
+    default:
+        // version 3 keys are obsolete
+        return {};
+    }
+    hashed.append(body);
+    return QCryptographicHash::hash(hashed, algorithm).toHex().toUpper().toStdString();
+}
+
+// walks the OpenPGP packets in data and collects the fingerprints of the
+// public key packets; stops at the first damaged or truncated packet
+static void collectOpenPGPFingerprints(QByteArrayView data, std::vector<std::string> &fingerprints)
+{
+    qsizetype pos = 0;
+    while (pos < data.size()) {
+        const unsigned int header = byteAt(data, pos++);
+        if (!(header & 0x80)) {
+            return;
+        }
+        unsigned int tag;
+        qsizetype length = 0;
+        if (header & 0x40) {
+            // new format packet
+            tag = header & 0x3f;
+            if (pos >= data.size()) {
+                return;
+            }
+            const unsigned int first = byteAt(data, pos++);
+            if (first < 192) {
+                length = first;
+            } else if (first < 224) {
+                if (pos >= data.size()) {
+                    return;
+                }
+                length = ((first - 192) << 8) + byteAt(data, pos++) + 192;
+            } else if (first == 255) {
+                if (pos + 4 > data.size()) {
+                    return;
+                }
+                for (int i = 0; i < 4; ++i) {
+                    length = (length << 8) | byteAt(data, pos++);
+                }
+            } else {
+                // partial body lengths are not allowed for key material
+                return;
+            }
+        } else {
+            // old format packet
+            tag = (header >> 2) & 0x0f;
+            const unsigned int lengthType = header & 0x03;
+            if (lengthType == 3) {
+                // indeterminate length
+                return;
+            }
+            const int numLengthBytes = 1 << lengthType;
+            if (pos + numLengthBytes > data.size()) {
+                return;
+            }
+            for (int i = 0; i < numLengthBytes; ++i) {
+                length = (length << 8) | byteAt(data, pos++);
+            }
+        }
+        if (length > data.size() - pos) {
+            return;
+        }
+        if (tag == publicKeyPacketTag) {
+            const std::string fingerprint = publicKeyFingerprint(data.sliced(pos, length));
+            if (!fingerprint.empty()) {
+                fingerprints.push_back(fingerprint);
+            }
+        }
+        pos += length;
+    }
+}
+}
+
+std::vector<std::string> Kleo::certificateFingerprints(GpgME::Protocol protocol, const QByteArray &data)
+{
+    std::vector<std::string> fingerprints;
+    if (protocol == GpgME::OpenPGP) {
+        if (!data.isEmpty() && (byteAt(data, 0) & 0x80)) {
+            collectOpenPGPFingerprints(data, fingerprints);
+        } else {
+            for (const auto &block : dearmor(data, isPublicKeyBlockBeginLine)) {
+                collectOpenPGPFingerprints(block, fingerprints);
+            }
+        }
+    } else if (protocol == GpgME::CMS) {
+        // the fingerprint of an X.509 certificate is the SHA-1 hash of its DER encoding
+        for (const auto &block : dearmor(data, isCertificateBeginLine)) {
+            if (isDERSequence(block)) {
+                fingerprints.push_back(QCryptographicHash::hash(block, QCryptographicHash::Sha1).toHex().toUpper().toStdString());
+            }
+        }
+    }
+    return fingerprints;
+}
@@ -0,0 +1,35 @@
+/* -*- mode: c++; c-basic-offset:4 -*-
+    utils/certificatefingerprints.h
+
+    This file is part of Kleopatra, the KDE keymanager
+    SPDX-FileCopyrightText: 2024 g10 Code GmbH
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <gpgme++/global.h>
+
+#include <string>
+#include <vector>
+
+class QByteArray;
+
+namespace Kleo
+{
+
+/**
+ * Returns the fingerprints of the certificates contained in @p data without
+ * importing them. The fingerprints are formatted like the fingerprints
+ * reported by the backend for imported certificates (upper-case hex).
+ *
+ * The data is parsed in-process, i.e. no backend process is started. For
+ * OpenPGP, the fingerprints of the public key packets (version 4 and later)
+ * of armored or binary public keys are returned; subkeys are skipped. For
+ * CMS, the fingerprints of PEM-encoded certificates are returned. Damaged or
+ * truncated data is skipped, i.e. the result may be incomplete.
+ */
+std::vector<std::string> certificateFingerprints(GpgME::Protocol protocol, const QByteArray &data);
+
+}
@@ -0,0 +1,103 @@
+/* -*- mode: c++; c-basic-offset:4 -*-
+    utils/compressedauditlogentry.cpp
+
+    This file is part of Kleopatra, the KDE keymanager
+    SPDX-FileCopyrightText: 2024 g10 Code GmbH
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <config-kleopatra.h>
+
+#include "compressedauditlogentry.h"
+
+#include <Libkleo/AuditLogEntry>
+
+#include <QCache>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <gpgme++/error.h>
+
+#include <atomic>
+#include <optional>
+
+using namespace Kleo;
+using namespace GpgME;
+
+namespace
+{
+// the number of audit logs that are kept uncompressed after they have been requested
+static const int maxUncompressedAuditLogs = 10;
+
+static std::atomic<quint64> nextId{1};
+
+class UncompressedAuditLogs
+{
+public:
+    static UncompressedAuditLogs &instance()
+    {
+        static UncompressedAuditLogs self;
+        return self;
+    }
+
+    std::optional<QString> find(quint64 id)
+    {
+        const QMutexLocker locker{&mutex};
+        if (const QString *text = cache.object(id)) {
+            return *text;
+        }
+        return {};
+    }
+
+    void insert(quint64 id, const QString &text)
+    {
+        const QMutexLocker locker{&mutex};
+        cache.insert(id, new QString{text});
+    }
+
+private:
+    UncompressedAuditLogs()
+        : cache{maxUncompressedAuditLogs}
+    {
+    }
+
+private:
+    QMutex mutex;
+    QCache<quint64, QString> cache;
+};
+}
+
+struct CompressedAuditLogEntry::Data {
+    quint64 id;
+    QByteArray compressedText;
+    Error error;
+};
+
+CompressedAuditLogEntry::CompressedAuditLogEntry(const AuditLogEntry &entry)
+    : d{std::make_shared<const Data>(Data{nextId++, entry.text().isEmpty() ? QByteArray{} : qCompress(entry.text().toUtf8()), entry.error()})}
+{
+}
+
+bool CompressedAuditLogEntry::isAvailable() const
+{
+    // same condition as in AuditLogEntry::asUrl()
+    return d && !d->error.code() && !d->compressedText.isEmpty();
+}
+
+AuditLogEntry CompressedAuditLogEntry::entry() const
+{
+    if (!d) {
+        return {};
+    }
+    if (d->compressedText.isEmpty()) {
+        return AuditLogEntry{QString{}, d->error};
+    }
+    auto &uncompressed = UncompressedAuditLogs::instance();
+    if (const auto text = uncompressed.find(d->id)) {
+        return AuditLogEntry{*text, d->error};
+    }
+    const QString text = QString::fromUtf8(qUncompress(d->compressedText));
+    uncompressed.insert(d->id, text);
+    return AuditLogEntry{text, d->error};
+}
@@ -0,0 +1,55 @@
+/* -*- mode: c++; c-basic-offset:4 -*-
+    utils/compressedauditlogentry.h
+
+    This file is part of Kleopatra, the KDE keymanager
+    SPDX-FileCopyrightText: 2024 g10 Code GmbH
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <memory>
+
+namespace Kleo
+{
+class AuditLogEntry;
+
+/**
+ * Holds an audit log in compressed form.
+ *
+ * The results of crypto operations keep their audit log although it is
+ * looked at for almost none of them. This class keeps the (highly redundant)
+ * HTML text compressed and uncompresses it only if the audit log is actually
+ * requested. The most recently requested audit logs are kept uncompressed in
+ * a small cache shared by all instances.
+ *
+ * Copies share the compressed data.
+ */
+class CompressedAuditLogEntry
+{
+public:
+    /**
+     * Creates an entry without audit log.
+     */
+    CompressedAuditLogEntry() = default;
+    explicit CompressedAuditLogEntry(const AuditLogEntry &entry);
+
+    /**
+     * Returns true if there is an audit log that can be shown, i.e. if it
+     * was retrieved successfully and isn't empty. Doesn't uncompress the
+     * audit log.
+     */
+    bool isAvailable() const;
+
+    /**
+     * Returns the uncompressed audit log.
+     */
+    AuditLogEntry entry() const;
+
+private:
+    struct Data;
+    std::shared_ptr<const Data> d;
+};
+
+}
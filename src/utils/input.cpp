@@ -17,6 +17,7 @@
 #include "kdpipeiodevice.h"
 #include "kleo_assert.h"
 #include "log.h"
+#include "unixpipeiodevice.h"
 #include "windowsprocessdevice.h"
 
 #include <Libkleo/Classify>
@@ -212,7 +213,11 @@ PipeInput::PipeInput(assuan_fd_t fd)
     : InputImplBase()
     , m_io()
 {
+#ifdef Q_OS_WIN
     std::shared_ptr<KDPipeIODevice> kdp(new KDPipeIODevice);
+#else
+    std::shared_ptr<UnixPipeIODevice> kdp(new UnixPipeIODevice);
+#endif
     errno = 0;
     if (!kdp->open(fd, QIODevice::ReadOnly))
         throw Exception(errno ? gpg_error_from_errno(errno) : gpg_error(GPG_ERR_EIO), i18n("Could not open FD %1 for reading", _detail::assuanFD2int(fd)));
@@ -0,0 +1,168 @@
+/* -*- mode: c++; c-basic-offset:4 -*-
+    utils/keycacheupdater.cpp
+
+    This file is part of Kleopatra, the KDE keymanager
+    SPDX-FileCopyrightText: 2024 g10 Code GmbH
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <config-kleopatra.h>
+
+#include "keycacheupdater.h"
+
+#include <Libkleo/KeyCache>
+
+#include <gpgme++/context.h>
+#include <gpgme++/error.h>
+#include <gpgme++/key.h>
+
+#include <QCoreApplication>
+#include <QPointer>
+#include <QThread>
+
+#include <algorithm>
+#include <memory>
+
+#include "kleopatra_debug.h"
+
+using namespace Kleo;
+using namespace GpgME;
+
+namespace
+{
+// above this number of certificates relisting the whole keyring is cheaper
+static const size_t maxCertificatesToRelist = 1000;
+// the patterns are passed to gpg on the command line
+static const size_t maxPatternsPerListing = 200;
+
+struct ListingResult {
+    std::vector<Key> keys;
+    Error error;
+};
+
+static ListingResult listKeys(Protocol protocol, const std::vector<std::string> &fingerprints)
+{
+    ListingResult result;
+    const std::unique_ptr<Context> ctx = Context::create(protocol);
+    if (!ctx) {
+        result.error = Error::fromCode(GPG_ERR_NOT_SUPPORTED);
+        return result;
+    }
+    // list the keys like the key cache does; signatures are needed for the remarks
+    unsigned int mode = GpgME::Local | GpgME::Validate | GpgME::WithSecret;
+    if (protocol == GpgME::OpenPGP) {
+        mode |= GpgME::Signatures | GpgME::SignatureNotations;
+    }
+    ctx->setKeyListMode(mode);
+
+    for (size_t start = 0; start < fingerprints.size(); start += maxPatternsPerListing) {
+        const size_t end = std::min(start + maxPatternsPerListing, fingerprints.size());
+        std::vector<const char *> patterns;
+        patterns.reserve(end - start + 1);
+        std::transform(fingerprints.begin() + start, fingerprints.begin() + end, std::back_inserter(patterns), [](const auto &fpr) {
+            return fpr.c_str();
+        });
+        patterns.push_back(nullptr);
+
+        if (const Error err = ctx->startKeyListing(patterns.data())) {
+            result.error = err;
+            return result;
+        }
+        Error err;
+        for (Key key = ctx->nextKey(err); !err && !key.isNull(); key = ctx->nextKey(err)) {
+            result.keys.push_back(key);
+        }
+        ctx->endKeyListing();
+        if (err && err.code() != GPG_ERR_EOF) {
+            result.error = err;
+            return result;
+        }
+    }
+    return result;
+}
+
+static void applyToKeyCache(const std::vector<std::string> &fingerprints, const std::vector<Key> &keys)
+{
+    const auto cache = KeyCache::mutableInstance();
+    std::vector<Key> removedKeys;
+    for (const auto &fpr : fingerprints) {
+        const bool listed = std::any_of(keys.cbegin(), keys.cend(), [&fpr](const auto &key) {
+            return key.primaryFingerprint() && fpr == key.primaryFingerprint();
+        });
+        if (!listed) {
+            const Key key = cache->findByFingerprint(fpr);
+            if (!key.isNull()) {
+                removedKeys.push_back(key);
+            }
+        }
+    }
+    if (!removedKeys.empty()) {
+        cache->remove(removedKeys);
+    }
+    if (!keys.empty()) {
+        cache->insert(keys);
+    }
+}
+
+// CA certificates affect the validity and the hierarchy of the certificates
+// they issued, so that those would have to be relisted as well
+static bool containsCACertificate(const std::vector<Key> &keys)
+{
+    return std::any_of(keys.cbegin(), keys.cend(), [](const auto &key) {
+        return key.protocol() == GpgME::CMS && (key.isRoot() || key.canCertify());
+    });
+}
+
+static void reloadKeyCache(Protocol protocol, const std::function<void()> &done)
+{
+    const auto cache = KeyCache::mutableInstance();
+    auto connection = std::make_shared<QMetaObject::Connection>();
+    *connection = QObject::connect(cache.get(), &KeyCache::keyListingDone, qApp, [connection, done]() {
+        QObject::disconnect(*connection);
+        done();
+    });
+    cache->startKeyListing(protocol);
+}
+}
+
+void Kleo::updateKeysInKeyCache(GpgME::Protocol protocol, const std::vector<std::string> &fingerprints, QObject *context, const std::function<void()> &done)
+{
+    const QPointer<QObject> guard = context;
+    const auto callDone = [guard, hadContext = context != nullptr, done]() {
+        if (done && (!hadContext || guard)) {
+            done();
+        }
+    };
+
+    if (fingerprints.size() > maxCertificatesToRelist) {
+        qCDebug(KLEOPATRA_LOG) << __func__ << "Reloading key cache instead of relisting" << fingerprints.size() << "certificates";
+        reloadKeyCache(protocol, callDone);
+        return;
+    }
+
+    qCDebug(KLEOPATRA_LOG) << __func__ << "Relisting" << fingerprints.size() << "certificates";
+    auto result = std::make_shared<ListingResult>();
+    QThread *thread = QThread::create([protocol, fingerprints, result]() {
+        *result = listKeys(protocol, fingerprints);
+    });
+    // the key cache is updated even if the context is gone
+    QObject::connect(thread, &QThread::finished, qApp, [protocol, fingerprints, result, callDone]() {
+        if (result->error) {
+            // the automatic refresh may have been skipped because of the
+            // change we were supposed to pick up; don't leave the key cache stale
+            qCWarning(KLEOPATRA_LOG) << "updateKeysInKeyCache: Relisting certificates failed:" << result->error.asString() << "- reloading key cache";
+            reloadKeyCache(protocol, callDone);
+            return;
+        } else if (containsCACertificate(result->keys)) {
+            qCDebug(KLEOPATRA_LOG) << "updateKeysInKeyCache: Reloading key cache because of CA certificates";
+            reloadKeyCache(protocol, callDone);
+            return;
+        } else {
+            applyToKeyCache(fingerprints, result->keys);
+        }
+        callDone();
+    });
+    QObject::connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+    thread->start();
+}
@@ -0,0 +1,41 @@
+/* -*- mode: c++; c-basic-offset:4 -*-
+    utils/keycacheupdater.h
+
+    This file is part of Kleopatra, the KDE keymanager
+    SPDX-FileCopyrightText: 2024 g10 Code GmbH
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <gpgme++/global.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+class QObject;
+
+namespace Kleo
+{
+
+/**
+ * Relists the certificates with the given fingerprints in the background and
+ * patches them into the key cache. Certificates that no longer exist are
+ * removed from the key cache. This is much cheaper than reloading the whole
+ * key cache after a local operation that changed only a few certificates.
+ * If there are very many fingerprints or if one of the certificates is a CMS
+ * CA certificate (which affects the certificates it issued), then the key
+ * cache is reloaded instead. The key cache is also reloaded if relisting the
+ * certificates fails.
+ *
+ * @p done is called after the key cache has been updated unless @p context
+ * has been destroyed in the meantime.
+ */
+void updateKeysInKeyCache(GpgME::Protocol protocol,
+                          const std::vector<std::string> &fingerprints,
+                          QObject *context = nullptr,
+                          const std::function<void()> &done = {});
+
+}
@@ -0,0 +1,331 @@
+/* -*- mode: c++; c-basic-offset:4 -*-
+    utils/keysearchindex.cpp
+
+    This file is part of Kleopatra, the KDE keymanager
+    SPDX-FileCopyrightText: 2024 g10 Code GmbH
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <config-kleopatra.h>
+
+#include "keysearchindex.h"
+
+#include <Libkleo/Dn>
+#include <Libkleo/KeyCache>
+#include <Libkleo/KeyGroup>
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <QThread>
+#include <QTimer>
+
+#include <algorithm>
+#include <iterator>
+
+#include "kleopatra_debug.h"
+
+using namespace Kleo;
+using namespace GpgME;
+
+namespace
+{
+// the posting lists of the remaining trigrams are not intersected once that
+// few candidates are left; verifying them is cheaper
+static const std::size_t maxCandidatesToVerify = 16;
+
+static std::uint64_t trigram(const QChar *chars)
+{
+    return (std::uint64_t(chars[0].unicode()) << 32) | (std::uint64_t(chars[1].unicode()) << 16) | chars[2].unicode();
+}
+
+// returns the sorted trigrams of text; trigrams spanning the separator of
+// different parts of the text are skipped
+static std::vector<std::uint64_t> trigrams(const QString &text)
+{
+    std::vector<std::uint64_t> result;
+    if (text.size() < 3) {
+        return result;
+    }
+    result.reserve(text.size() - 2);
+    const QChar *chars = text.constData();
+    for (qsizetype i = 0; i + 3 <= text.size(); ++i) {
+        if (chars[i] == QLatin1Char('\n') || chars[i + 1] == QLatin1Char('\n') || chars[i + 2] == QLatin1Char('\n')) {
+            continue;
+        }
+        result.push_back(trigram(chars + i));
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+template<typename T>
+static std::vector<std::size_t> intersection(const std::vector<std::size_t> &sorted, const std::vector<T> &otherSorted)
+{
+    std::vector<std::size_t> result;
+    std::set_intersection(sorted.begin(), sorted.end(), otherSorted.begin(), otherSorted.end(), std::back_inserter(result));
+    return result;
+}
+}
+
+KeySearchIndex::KeySearchIndex(const std::vector<Key> &keys)
+{
+    m_entries.reserve(keys.size());
+    m_entriesByFingerprint.reserve(keys.size());
+    for (const auto &key : keys) {
+        if (!key.primaryFingerprint()) {
+            continue;
+        }
+        const auto entry = static_cast<std::uint32_t>(m_entries.size());
+        m_entriesByFingerprint.emplace(key.primaryFingerprint(), entry);
+        m_entries.push_back({key, searchableText(key)});
+        // the entries are added in ascending order, so that the lists stay sorted
+        for (const auto t : trigrams(m_entries.back().text)) {
+            m_entriesByTrigram[t].push_back(entry);
+        }
+    }
+}
+
+QString KeySearchIndex::normalizedSearchText(const QString &text)
+{
+    return text.trimmed().toLower();
+}
+
+QString KeySearchIndex::searchableText(const UserID &userID)
+{
+    // the parts are separated by line breaks, so that a search text (which
+    // never contains a line break) cannot match across parts
+    QStringList parts;
+    const QString id = QString::fromUtf8(userID.id());
+    parts.push_back(id);
+    if (userID.parent().protocol() == GpgME::CMS && !id.startsWith(QLatin1Char('<'))) {
+        // the backend escapes non-ASCII characters in distinguished names
+        parts.push_back(DN(id).prettyDN());
+    }
+    if (userID.email() && *userID.email()) {
+        parts.push_back(QString::fromUtf8(userID.email()));
+    }
+    return parts.join(QLatin1Char('\n')).toLower();
+}
+
+QString KeySearchIndex::searchableText(const Key &key)
+{
+    QStringList parts;
+    for (const auto &uid : key.userIDs()) {
+        parts.push_back(searchableText(uid));
+    }
+    for (const auto &subkey : key.subkeys()) {
+        parts.push_back(QString::fromLatin1(subkey.fingerprint()).toLower());
+        parts.push_back(QString::fromLatin1(subkey.keyID()).toLower());
+    }
+    return parts.join(QLatin1Char('\n'));
+}
+
+std::size_t KeySearchIndex::size() const
+{
+    return m_entries.size();
+}
+
+const Key &KeySearchIndex::key(std::size_t entry) const
+{
+    return m_entries[entry].key;
+}
+
+std::optional<std::size_t> KeySearchIndex::entry(const char *fingerprint) const
+{
+    if (!fingerprint) {
+        return {};
+    }
+    const auto it = m_entriesByFingerprint.find(fingerprint);
+    if (it == m_entriesByFingerprint.end()) {
+        return {};
+    }
+    return it->second;
+}
+
+std::optional<std::vector<std::size_t>> KeySearchIndex::trigramCandidates(const QString &needle) const
+{
+    const auto needleTrigrams = trigrams(needle);
+    if (needleTrigrams.empty()) {
+        return {};
+    }
+    std::vector<const std::vector<std::uint32_t> *> lists;
+    lists.reserve(needleTrigrams.size());
+    for (const auto t : needleTrigrams) {
+        const auto it = m_entriesByTrigram.find(t);
+        if (it == m_entriesByTrigram.end()) {
+            // some trigram of the search text doesn't occur anywhere
+            return std::vector<std::size_t>{};
+        }
+        lists.push_back(&it->second);
+    }
+    // intersect the shortest lists first
+    std::sort(lists.begin(), lists.end(), [](const auto *lhs, const auto *rhs) {
+        return lhs->size() < rhs->size();
+    });
+    std::vector<std::size_t> candidates(lists.front()->begin(), lists.front()->end());
+    for (auto it = lists.begin() + 1; it != lists.end() && candidates.size() > maxCandidatesToVerify; ++it) {
+        candidates = intersection(candidates, **it);
+    }
+    return candidates;
+}
+
+std::vector<std::size_t> KeySearchIndex::matches(const QString &needle, const std::vector<std::size_t> *candidates) const
+{
+    std::vector<std::size_t> trigramMatches;
+    if (auto c = trigramCandidates(needle)) {
+        trigramMatches = candidates ? intersection(*c, *candidates) : std::move(*c);
+        candidates = &trigramMatches;
+    }
+
+    // the candidates are verified because the trigrams may occur in a different order
+    std::vector<std::size_t> result;
+    if (candidates) {
+        for (const auto entry : *candidates) {
+            if (m_entries[entry].text.contains(needle)) {
+                result.push_back(entry);
+            }
+        }
+    } else {
+        for (std::size_t entry = 0; entry < m_entries.size(); ++entry) {
+            if (m_entries[entry].text.contains(needle)) {
+                result.push_back(entry);
+            }
+        }
+    }
+    return result;
+}
+
+KeySearchResult::KeySearchResult(const QString &needle, const std::shared_ptr<const KeySearchIndex> &index, std::vector<std::size_t> entries)
+    : m_needle{needle}
+    , m_index{index}
+    , m_entries{std::move(entries)}
+{
+    if (m_index) {
+        m_matched.resize(m_index->size(), false);
+        for (const auto entry : m_entries) {
+            m_matched[entry] = true;
+        }
+    }
+}
+
+KeySearchResult KeySearchResult::search(const QString &text)
+{
+    const QString needle = KeySearchIndex::normalizedSearchText(text);
+    if (needle.isEmpty()) {
+        return {};
+    }
+    const auto index = KeySearchIndexProvider::instance()->index();
+    if (!index) {
+        return {needle, nullptr, {}};
+    }
+    return {needle, index, index->matches(needle)};
+}
+
+const QString &KeySearchResult::needle() const
+{
+    return m_needle;
+}
+
+const std::shared_ptr<const KeySearchIndex> &KeySearchResult::index() const
+{
+    return m_index;
+}
+
+const std::vector<std::size_t> &KeySearchResult::entries() const
+{
+    return m_entries;
+}
+
+bool KeySearchResult::matches(const Key &key) const
+{
+    if (m_needle.isEmpty()) {
+        return true;
+    }
+    if (m_index) {
+        const auto entry = m_index->entry(key.primaryFingerprint());
+        // the index may not know the certificate or an outdated version of it
+        if (entry && m_index->key(*entry).impl() == key.impl()) {
+            return m_matched[*entry];
+        }
+    }
+    return KeySearchIndex::searchableText(key).contains(m_needle);
+}
+
+bool KeySearchResult::matches(const UserID &userID) const
+{
+    if (m_needle.isEmpty()) {
+        return true;
+    }
+    const Key key = userID.parent();
+    if (!matches(key)) {
+        return false;
+    }
+    if (KeySearchIndex::searchableText(userID).contains(m_needle)) {
+        return true;
+    }
+    // the certificate matches; if no user ID matches, then it matches by fingerprint
+    const auto userIDs = key.userIDs();
+    return std::none_of(userIDs.begin(), userIDs.end(), [this](const auto &uid) {
+        return KeySearchIndex::searchableText(uid).contains(m_needle);
+    });
+}
+
+bool KeySearchResult::matches(const KeyGroup &group) const
+{
+    return m_needle.isEmpty() || group.name().toLower().contains(m_needle);
+}
+
+KeySearchIndexProvider::KeySearchIndexProvider(QObject *parent)
+    : QObject{parent}
+{
+    connect(KeyCache::instance().get(), &KeyCache::keysMayHaveChanged, this, &KeySearchIndexProvider::scheduleRebuild);
+    scheduleRebuild();
+}
+
+KeySearchIndexProvider *KeySearchIndexProvider::instance()
+{
+    static const auto self = new KeySearchIndexProvider{qApp};
+    return self;
+}
+
+std::shared_ptr<const KeySearchIndex> KeySearchIndexProvider::index() const
+{
+    return m_index;
+}
+
+void KeySearchIndexProvider::scheduleRebuild()
+{
+    if (m_rebuildScheduled) {
+        return;
+    }
+    m_rebuildScheduled = true;
+    if (!m_building) {
+        // coalesce the change notifications of a key listing
+        QTimer::singleShot(0, this, &KeySearchIndexProvider::rebuild);
+    }
+}
+
+void KeySearchIndexProvider::rebuild()
+{
+    m_rebuildScheduled = false;
+    m_building = true;
+    auto index = std::make_shared<std::shared_ptr<const KeySearchIndex>>();
+    QThread *thread = QThread::create([keys = KeyCache::instance()->keys(), index]() {
+        *index = std::make_shared<const KeySearchIndex>(keys);
+    });
+    connect(thread, &QThread::finished, this, [this, index]() {
+        m_index = *index;
+        m_building = false;
+        qCDebug(KLEOPATRA_LOG) << "KeySearchIndexProvider: Indexed" << m_index->size() << "certificates";
+        Q_EMIT indexChanged();
+        if (m_rebuildScheduled) {
+            rebuild();
+        }
+    });
+    connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+    thread->start();
+}
+
+#include "moc_keysearchindex.cpp"
@@ -0,0 +1,158 @@
+/* -*- mode: c++; c-basic-offset:4 -*-
+    utils/keysearchindex.h
+
+    This file is part of Kleopatra, the KDE keymanager
+    SPDX-FileCopyrightText: 2024 g10 Code GmbH
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QObject>
+#include <QString>
+
+#include <gpgme++/key.h>
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Kleo
+{
+class KeyGroup;
+
+/**
+ * An immutable index for searching certificates by the text the user typed.
+ * For each certificate the user IDs, email addresses, fingerprints and key
+ * IDs are stored lower-cased together with a trigram index, so that the
+ * candidates for a search text of three or more characters are found without
+ * looking at all certificates. Since the index is immutable it can be used by
+ * several threads.
+ */
+class KeySearchIndex
+{
+public:
+    explicit KeySearchIndex(const std::vector<GpgME::Key> &keys);
+
+    /**
+     * Returns the text to search for when the user entered @p text, i.e. the
+     * trimmed and lower-cased text.
+     */
+    static QString normalizedSearchText(const QString &text);
+
+    /**
+     * Returns the lower-cased text that a search text is matched against for
+     * @p key. Useful for certificates that are not in the index.
+     */
+    static QString searchableText(const GpgME::Key &key);
+
+    /**
+     * Returns the lower-cased text that a search text is matched against for
+     * the user ID @p userID (without the fingerprints of the certificate).
+     */
+    static QString searchableText(const GpgME::UserID &userID);
+
+    std::size_t size() const;
+    const GpgME::Key &key(std::size_t entry) const;
+
+    /**
+     * Returns the entry of the certificate with the given primary fingerprint.
+     */
+    std::optional<std::size_t> entry(const char *fingerprint) const;
+
+    /**
+     * Returns the entries (in ascending order) of all certificates matching
+     * the normalized search text @p needle. If @p candidates (in ascending
+     * order) is given, then only those entries are considered. This allows
+     * narrowing the result of a previous search if the user just continued
+     * typing.
+     */
+    std::vector<std::size_t> matches(const QString &needle, const std::vector<std::size_t> *candidates = nullptr) const;
+
+private:
+    std::optional<std::vector<std::size_t>> trigramCandidates(const QString &needle) const;
+
+private:
+    struct Entry {
+        GpgME::Key key;
+        QString text;
+    };
+    std::vector<Entry> m_entries;
+    std::unordered_map<std::string, std::size_t> m_entriesByFingerprint;
+    // entries (in ascending order) by the trigrams occurring in their text
+    std::unordered_map<std::uint64_t, std::vector<std::uint32_t>> m_entriesByTrigram;
+};
+
+/**
+ * The result of a search in a KeySearchIndex. Certificates that are not
+ * contained in the index (e.g. because the index hasn't been updated yet)
+ * are matched directly.
+ */
+class KeySearchResult
+{
+public:
+    /**
+     * Creates the result of an empty search, i.e. everything matches.
+     */
+    KeySearchResult() = default;
+    KeySearchResult(const QString &needle, const std::shared_ptr<const KeySearchIndex> &index, std::vector<std::size_t> entries);
+
+    /**
+     * Searches for @p text in the current index of the key cache.
+     */
+    static KeySearchResult search(const QString &text);
+
+    const QString &needle() const;
+    const std::shared_ptr<const KeySearchIndex> &index() const;
+    const std::vector<std::size_t> &entries() const;
+
+    bool matches(const GpgME::Key &key) const;
+    /**
+     * Returns true if the user ID matches the search text or if its
+     * certificate matches by fingerprint or key ID.
+     */
+    bool matches(const GpgME::UserID &userID) const;
+    bool matches(const KeyGroup &group) const;
+
+private:
+    QString m_needle;
+    std::shared_ptr<const KeySearchIndex> m_index;
+    std::vector<std::size_t> m_entries;
+    std::vector<bool> m_matched;
+};
+
+/**
+ * Keeps a search index of the certificates in the key cache. The index is
+ * rebuilt in a worker thread whenever the key cache may have changed.
+ */
+class KeySearchIndexProvider : public QObject
+{
+    Q_OBJECT
+public:
+    static KeySearchIndexProvider *instance();
+
+    /**
+     * Returns the current index. Returns nullptr until the first index has
+     * been built.
+     */
+    std::shared_ptr<const KeySearchIndex> index() const;
+
+Q_SIGNALS:
+    void indexChanged();
+
+private:
+    explicit KeySearchIndexProvider(QObject *parent);
+    void scheduleRebuild();
+    void rebuild();
+
+private:
+    std::shared_ptr<const KeySearchIndex> m_index;
+    bool m_building = false;
+    bool m_rebuildScheduled = false;
+};
+
+}
@@ -18,6 +18,9 @@
 #include "kleo_assert.h"
 #include "log.h"
 #include "overwritedialog.h"
+#include "unixpipeiodevice.h"
+
+#include "fileoperationspreferences.h"
 
 #include <Libkleo/KleoException>
 
@@ -32,19 +35,29 @@
 #include <QClipboard>
 #include <QDir>
 #include <QFileInfo>
+#include <QMutex>
 #include <QPointer>
 #include <QProcess>
+#include <QRandomGenerator>
+#include <QScopeGuard>
 #include <QString>
 #include <QTemporaryFile>
+#include <QThreadPool>
 #include <QTimer>
 #include <QUrl>
 #include <QWidget>
 
 #ifdef Q_OS_WIN
 #include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
 #endif
 
 #include <cerrno>
+#include <cstring>
+#include <set>
+#include <utility>
 
 using namespace Kleo;
 using namespace Kleo::_detail;
@@ -92,6 +105,38 @@ void OverwritePolicy::setPolicy(Policy policy)
 namespace
 {
 
+// flushes the content of the file (or the entries of the directory) to disk
+static bool syncFile(const QString &fileName)
+{
+#ifdef Q_OS_WIN
+    QFile file{fileName};
+    if (!file.open(QIODevice::ReadWrite)) {
+        return false;
+    }
+    return FlushFileBuffers((HANDLE)_get_osfhandle(file.handle()));
+#else
+    const int fd = ::open(QFile::encodeName(fileName).constData(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    const bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+#endif
+}
+
+static void syncDirectory(const QString &path)
+{
+#ifndef Q_OS_WIN
+    // makes the directory entries of new files durable; not needed on Windows
+    if (!syncFile(path)) {
+        qCDebug(KLEOPATRA_LOG) << __func__ << "Failed to sync directory" << path << ":" << strerror(errno);
+    }
+#else
+    Q_UNUSED(path)
+#endif
+}
+
 class TemporaryFile : public QTemporaryFile
 {
 public:
@@ -321,6 +366,12 @@ private:
     bool m_binaryOpt : 1;
 };
 
+#ifdef Q_OS_WIN
+using PipeIODevice = KDPipeIODevice;
+#else
+using PipeIODevice = UnixPipeIODevice;
+#endif
+
 class PipeOutput : public OutputImplBase
 {
 public:
@@ -340,7 +391,7 @@ public:
     }
 
 private:
-    std::shared_ptr<inhibit_close<KDPipeIODevice>> m_io;
+    std::shared_ptr<inhibit_close<PipeIODevice>> m_io;
 };
 
 class ProcessStdInOutput : public OutputImplBase
@@ -403,6 +454,12 @@ public:
     ~FileOutput() override
     {
         qCDebug(KLEOPATRA_LOG) << this;
+#ifndef Q_OS_WIN
+        // an unnamed file that wasn't linked into place vanishes when it's closed
+        if (m_anonymousFd >= 0) {
+            ::close(m_anonymousFd);
+        }
+#endif
     }
 
     QString label() const override
@@ -411,6 +468,9 @@ public:
     }
     std::shared_ptr<QIODevice> ioDevice() const override
     {
+        if (m_anonymousFile) {
+            return m_anonymousFile;
+        }
         return m_tmpFile;
     }
     void doFinalize() override;
@@ -422,16 +482,31 @@ public:
     {
         return m_fileName;
     }
+    void setFileSyncList(const std::shared_ptr<FileSyncList> &list) override
+    {
+        m_fileSyncList = list;
+    }
 
     void attachInput(const std::shared_ptr<OutputInput> &input)
     {
         m_attachedInput = std::weak_ptr<OutputInput>(input);
     }
 
+private:
+    bool openAnonymousFile();
+    void finalizeAnonymousFile();
+    void fileWritten();
+
 private:
     QString m_fileName;
     std::shared_ptr<TemporaryFile> m_tmpFile;
+    // an unnamed file in the destination directory (Linux's O_TMPFILE) that
+    // is linked into place when the output is finalized
+    int m_anonymousFd = -1;
+    std::shared_ptr<QFile> m_anonymousFile;
     const std::shared_ptr<OverwritePolicy> m_policy;
+    const int m_syncPolicy;
+    std::shared_ptr<FileSyncList> m_fileSyncList;
     std::weak_ptr<OutputInput> m_attachedInput;
 };
 
@@ -520,7 +595,7 @@ std::shared_ptr<Output> Output::createFromPipeDevice(assuan_fd_t fd, const QStri
 
 PipeOutput::PipeOutput(assuan_fd_t fd)
     : OutputImplBase()
-    , m_io(new inhibit_close<KDPipeIODevice>)
+    , m_io(new inhibit_close<PipeIODevice>)
 {
     errno = 0;
     if (!m_io->open(fd, QIODevice::WriteOnly))
@@ -542,15 +617,190 @@ std::shared_ptr<Output> Output::createFromFile(const QString &fileName, const st
 FileOutput::FileOutput(const QString &fileName, const std::shared_ptr<OverwritePolicy> &policy)
     : OutputImplBase()
     , m_fileName(fileName)
-    , m_tmpFile(new TemporaryFile(fileName))
     , m_policy(policy)
+    , m_syncPolicy(FileOperationsPreferences().fileSyncPolicy())
 {
     Q_ASSERT(m_policy);
+    if (openAnonymousFile()) {
+        return;
+    }
+    // the temporary file is created next to the destination file (with the
+    // name of the destination file plus a random suffix), so that it can be
+    // renamed instead of copied when the output is finalized
+    m_tmpFile.reset(new TemporaryFile(fileName));
     errno = 0;
     if (!m_tmpFile->openNonInheritable())
         throw Exception(errno ? gpg_error_from_errno(errno) : gpg_error(GPG_ERR_EIO), i18n("Could not create temporary file for output \"%1\"", fileName));
 }
 
+bool FileOutput::openAnonymousFile()
+{
+#ifdef O_TMPFILE
+    // the unnamed file is linked into place via /proc/self/fd
+    static const bool haveProcFd = QFileInfo(QStringLiteral("/proc/self/fd")).isDir();
+    if (!haveProcFd) {
+        return false;
+    }
+    const QString directory = QFileInfo(m_fileName).absolutePath();
+    const int fd = ::open(QFile::encodeName(directory).constData(), O_TMPFILE | O_WRONLY | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        // not supported by the file system (or the kernel)
+        qCDebug(KLEOPATRA_LOG) << this << "Cannot create unnamed file in" << directory << ":" << strerror(errno);
+        return false;
+    }
+    auto file = std::make_shared<QFile>();
+    if (!file->open(fd, QIODevice::WriteOnly, QFileDevice::DontCloseHandle)) {
+        ::close(fd);
+        return false;
+    }
+    m_anonymousFd = fd;
+    m_anonymousFile = file;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void FileOutput::finalizeAnonymousFile()
+{
+#ifdef O_TMPFILE
+    kleo_assert(m_anonymousFile);
+    kleo_assert(m_anonymousFd >= 0);
+
+    if (m_anonymousFile->isOpen()) {
+        // flushes the buffered data; the file descriptor stays open
+        m_anonymousFile->close();
+    }
+    QPointer<QObject> guard = m_anonymousFile.get();
+    m_anonymousFile.reset();
+    kleo_assert(!guard); // if this triggers, we need to audit for holder of std::shared_ptr<QIODevice>s.
+
+    const int fd = std::exchange(m_anonymousFd, -1);
+    const auto closeFd = qScopeGuard([fd]() {
+        ::close(fd);
+    });
+
+    if (m_syncPolicy == FileOperationsPreferences::EnumFileSyncPolicy::SyncEachFile && ::fsync(fd) != 0) {
+        throw Exception(gpg_error_from_errno(errno), i18n(R"(Could not write file "%1" to disk)", m_fileName));
+    }
+
+    const QByteArray fdPath = "/proc/self/fd/" + QByteArray::number(fd);
+    const auto linkTo = [&fdPath](const QString &fileName) {
+        return ::linkat(AT_FDCWD, fdPath.constData(), AT_FDCWD, QFile::encodeName(fileName).constData(), AT_SYMLINK_FOLLOW) == 0;
+    };
+
+    qCDebug(KLEOPATRA_LOG) << this << "linking unnamed file to" << m_fileName;
+    if (linkTo(m_fileName)) {
+        fileWritten();
+        return;
+    }
+    if (errno != EEXIST) {
+        throw Exception(gpg_error_from_errno(errno), i18n(R"(Could not create file "%1")", m_fileName));
+    }
+
+    const auto policyAndFileName = m_policy->obtainOverwritePermission(m_fileName);
+    switch (policyAndFileName.policy) {
+    case OverwritePolicy::Cancel:
+        throw Exception(gpg_error(GPG_ERR_CANCELED), i18n("Overwriting declined"));
+    case OverwritePolicy::Overwrite: {
+        // link the file under a temporary name and then replace the existing
+        // file atomically
+        QString tmpFileName;
+        for (int attempt = 0; attempt < 100 && tmpFileName.isEmpty(); ++attempt) {
+            const QString candidate = m_fileName + QLatin1Char('.') + QString::number(QRandomGenerator::global()->generate(), 36);
+            if (linkTo(candidate)) {
+                tmpFileName = candidate;
+            } else if (errno != EEXIST) {
+                break;
+            }
+        }
+        if (tmpFileName.isEmpty()) {
+            throw Exception(errno ? gpg_error_from_errno(errno) : gpg_error(GPG_ERR_EIO), i18n("Could not create temporary file for output \"%1\"", m_fileName));
+        }
+        qCDebug(KLEOPATRA_LOG) << this << "replacing" << m_fileName << "with" << tmpFileName;
+        if (::rename(QFile::encodeName(tmpFileName).constData(), QFile::encodeName(m_fileName).constData()) != 0) {
+            const int err = errno;
+            ::unlink(QFile::encodeName(tmpFileName).constData());
+            throw Exception(gpg_error_from_errno(err), i18n(R"(Could not rename file "%1" to "%2")", tmpFileName, m_fileName));
+        }
+        fileWritten();
+        return;
+    }
+    case OverwritePolicy::Rename:
+        m_fileName = policyAndFileName.fileName;
+        qCDebug(KLEOPATRA_LOG) << this << "linking unnamed file to" << m_fileName;
+        if (linkTo(m_fileName)) {
+            fileWritten();
+            return;
+        }
+        throw Exception(gpg_error_from_errno(errno), i18n(R"(Could not create file "%1")", m_fileName));
+    case OverwritePolicy::None:
+    case OverwritePolicy::Ask:
+    case OverwritePolicy::Append:
+    case OverwritePolicy::Skip:
+        qCDebug(KLEOPATRA_LOG) << "Unexpected OverwritePolicy result" << policyAndFileName.policy << "for" << m_fileName;
+    };
+    throw Exception(gpg_error(GPG_ERR_EEXIST), i18n(R"(Could not create file "%1")", m_fileName));
+#endif
+}
+
+void FileOutput::fileWritten()
+{
+    switch (m_syncPolicy) {
+    case FileOperationsPreferences::EnumFileSyncPolicy::SyncEachFile:
+        // the content of the file has been synced before it was moved into place
+        syncDirectory(QFileInfo(m_fileName).absolutePath());
+        break;
+    case FileOperationsPreferences::EnumFileSyncPolicy::SyncWhenDone:
+        if (m_fileSyncList) {
+            m_fileSyncList->addFile(m_fileName);
+        } else {
+            // the output isn't part of a collection of tasks
+            FileSyncList list;
+            list.addFile(m_fileName);
+            list.syncFiles();
+        }
+        break;
+    default:
+        break;
+    }
+
+    if (!m_attachedInput.expired()) {
+        m_attachedInput.lock()->outputFinalized();
+    }
+}
+
+void FileSyncList::addFile(const QString &fileName)
+{
+    const QMutexLocker locker{&m_mutex};
+    m_fileNames.push_back(fileName);
+}
+
+void FileSyncList::syncFiles()
+{
+    QStringList fileNames;
+    {
+        const QMutexLocker locker{&m_mutex};
+        fileNames.swap(m_fileNames);
+    }
+    if (fileNames.empty()) {
+        return;
+    }
+    qCDebug(KLEOPATRA_LOG) << __func__ << "Syncing" << fileNames.size() << "file(s)";
+    QThreadPool::globalInstance()->start([fileNames]() {
+        std::set<QString> directories;
+        for (const QString &fileName : fileNames) {
+            if (!syncFile(fileName)) {
+                qCWarning(KLEOPATRA_LOG) << "Failed to sync" << fileName;
+            }
+            directories.insert(QFileInfo(fileName).absolutePath());
+        }
+        for (const QString &directory : directories) {
+            syncDirectory(directory);
+        }
+    });
+}
+
 static QString suggestFileName(const QString &fileName)
 {
     const QFileInfo fileInfo{fileName};
@@ -620,6 +870,11 @@ void FileOutput::doFinalize()
 {
     qCDebug(KLEOPATRA_LOG) << this;
 
+    if (m_anonymousFile) {
+        finalizeAnonymousFile();
+        return;
+    }
+
     struct Remover {
         QString file;
         ~Remover()
@@ -662,13 +917,14 @@ void FileOutput::doFinalize()
         }
     }
 
+    if (m_syncPolicy == FileOperationsPreferences::EnumFileSyncPolicy::SyncEachFile && !syncFile(tmpFileName)) {
+        throw Exception(errno ? gpg_error_from_errno(errno) : gpg_error(GPG_ERR_EIO), i18n(R"(Could not write file "%1" to disk)", m_fileName));
+    }
+
     qCDebug(KLEOPATRA_LOG) << this << "renaming" << tmpFileName << "->" << m_fileName;
     if (QFile::rename(tmpFileName, m_fileName)) {
         qCDebug(KLEOPATRA_LOG) << this << "renaming succeeded";
-
-        if (!m_attachedInput.expired()) {
-            m_attachedInput.lock()->outputFinalized();
-        }
+        fileWritten();
         return;
     }
 
@@ -680,6 +936,15 @@ void FileOutput::doFinalize()
         case OverwritePolicy::Cancel:
             throw Exception(gpg_error(GPG_ERR_CANCELED), i18n("Overwriting declined"));
         case OverwritePolicy::Overwrite: {
+#ifndef Q_OS_WIN
+            // rename() replaces the existing file atomically
+            qCDebug(KLEOPATRA_LOG) << this << "replacing" << m_fileName << "with" << tmpFileName;
+            if (::rename(QFile::encodeName(tmpFileName).constData(), QFile::encodeName(m_fileName).constData()) == 0) {
+                fileWritten();
+                return;
+            }
+            throw Exception(gpg_error_from_errno(errno), i18n(R"(Could not rename file "%1" to "%2")", tmpFileName, m_fileName));
+#else
             qCDebug(KLEOPATRA_LOG) << this << "going to remove file for overwriting" << m_fileName;
             if (!QFile::remove(m_fileName)) {
                 throw Exception(errno ? gpg_error_from_errno(errno) : gpg_error(GPG_ERR_EIO),
@@ -687,6 +952,7 @@ void FileOutput::doFinalize()
             }
             qCDebug(KLEOPATRA_LOG) << this << "removing file to overwrite succeeded";
             break;
+#endif
         }
         case OverwritePolicy::Rename: {
             m_fileName = policyAndFileName.fileName;
@@ -703,10 +969,7 @@ void FileOutput::doFinalize()
     qCDebug(KLEOPATRA_LOG) << this << "renaming" << tmpFileName << "->" << m_fileName;
     if (QFile::rename(tmpFileName, m_fileName)) {
         qCDebug(KLEOPATRA_LOG) << this << "renaming succeeded";
-
-        if (!m_attachedInput.expired()) {
-            m_attachedInput.lock()->outputFinalized();
-        }
+        fileWritten();
         return;
     }
 
@@ -11,6 +11,7 @@
 
 #include <assuan.h> // for assuan_fd_t
 
+#include <QMutex>
 #include <QString>
 #include <QStringList>
 
@@ -68,6 +69,27 @@ private:
     const std::unique_ptr<Private> d;
 };
 
+/**
+ * Collects the files written by file outputs if the file sync policy is
+ * "sync when done", so that they are flushed to disk together after all
+ * tasks of a TaskCollection have finished. Thread-safe.
+ */
+class FileSyncList
+{
+public:
+    void addFile(const QString &fileName);
+
+    /**
+     * Flushes the collected files and their directories to disk in the
+     * background and clears the list.
+     */
+    void syncFiles();
+
+private:
+    QMutex m_mutex;
+    QStringList m_fileNames;
+};
+
 class Output
 {
 public:
@@ -91,6 +113,15 @@ public:
     {
         return {};
     }
+    /**
+     * Sets the list the written file is added to if the file sync policy is
+     * "sync when done". Without list the file is flushed to disk right after
+     * it has been written.
+     */
+    virtual void setFileSyncList(const std::shared_ptr<FileSyncList> &list)
+    {
+        Q_UNUSED(list)
+    }
 
     static std::shared_ptr<Output> createFromFile(const QString &fileName, const std::shared_ptr<OverwritePolicy> &);
     static std::shared_ptr<Output> createFromFile(const QString &fileName, bool forceOverwrite);
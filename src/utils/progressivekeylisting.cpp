@@ -0,0 +1,310 @@
+/* -*- mode: c++; c-basic-offset:4 -*-
+    utils/progressivekeylisting.cpp
+
+    This file is part of Kleopatra, the KDE keymanager
+    SPDX-FileCopyrightText: 2024 g10 Code GmbH
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <config-kleopatra.h>
+
+#include "progressivekeylisting.h"
+
+#include <settings.h>
+
+#include <Libkleo/KeyCache>
+#include <Libkleo/KeyListModel>
+
+#include <gpgme++/context.h>
+#include <gpgme++/error.h>
+#include <gpgme++/key.h>
+
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QThread>
+#include <QTimer>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <utility>
+
+#include "kleopatra_debug.h"
+
+using namespace Kleo;
+using namespace GpgME;
+
+namespace
+{
+// interval for taking the listed keys from the worker threads
+static const int pollIntervalInMilliseconds = 50;
+// the keys are added in chunks until this time is used up; then the event
+// loop gets the chance to paint a frame
+static const int maxMillisecondsPerSlice = 10;
+static const std::size_t keysPerChunk = 50;
+// the key cache lists all certificates anyway; we only need enough of them
+// to fill the first screen
+static const std::size_t maxListedKeys = 200;
+
+// the state shared with the worker threads
+struct ListingState {
+    std::mutex mutex;
+    std::vector<Key> keys;
+    std::size_t numListedKeys = 0;
+    std::atomic_bool canceled = false;
+};
+
+static void listKeys(Protocol protocol, const std::shared_ptr<ListingState> &state)
+{
+    const std::unique_ptr<Context> ctx = Context::create(protocol);
+    if (ctx) {
+        // like the key cache, but without signatures which are only needed for the remarks
+        ctx->setKeyListMode(GpgME::Local | GpgME::Validate | GpgME::WithSecret);
+        if (const Error err = ctx->startKeyListing()) {
+            qCWarning(KLEOPATRA_LOG) << "ProgressiveKeyListing: Starting the key listing failed:" << err.asString();
+        } else {
+            Error err;
+            for (Key key = ctx->nextKey(err); !err && !key.isNull(); key = ctx->nextKey(err)) {
+                bool enough;
+                {
+                    const std::lock_guard lock{state->mutex};
+                    state->keys.push_back(key);
+                    enough = ++state->numListedKeys >= maxListedKeys;
+                }
+                if (enough || state->canceled) {
+                    // don't let gpg list the remaining keys for nothing
+                    ctx->cancelPendingOperation();
+                    break;
+                }
+            }
+            ctx->endKeyListing();
+        }
+    }
+}
+}
+
+class ProgressiveKeyListing::Private
+{
+    friend class ::Kleo::ProgressiveKeyListing;
+    ProgressiveKeyListing *const q;
+
+public:
+    Private(ProgressiveKeyListing *qq, const std::vector<AbstractKeyListModel *> &models, KeyList::Options options);
+    ~Private();
+
+private:
+    void startListing(Protocol protocol);
+    void takeListedKeys();
+    void addPendingKeys();
+    void scheduleAddingPendingKeys();
+    void addKeysFromKeyCache();
+    void finish();
+    void switchModelsToKeyCache();
+
+private:
+    std::vector<QPointer<AbstractKeyListModel>> models;
+    KeyList::Options options;
+    std::shared_ptr<ListingState> state = std::make_shared<ListingState>();
+    std::vector<Key> pendingKeys;
+    // the keys listed by us that have been added to the models
+    std::vector<Key> preliminaryKeys;
+    std::size_t numAddedKeys = 0;
+    QTimer pollTimer;
+    QMetaObject::Connection keyCacheConnection;
+    bool addingScheduled = false;
+    bool addingKeysFromKeyCache = false;
+    bool finished = false;
+    bool switchedToKeyCache = false;
+};
+
+ProgressiveKeyListing::Private::Private(ProgressiveKeyListing *qq, const std::vector<AbstractKeyListModel *> &models_, KeyList::Options options_)
+    : q{qq}
+    , models(models_.begin(), models_.end())
+    , options{options_}
+{
+    pollTimer.setInterval(pollIntervalInMilliseconds);
+    QObject::connect(&pollTimer, &QTimer::timeout, q, [this]() {
+        takeListedKeys();
+    });
+}
+
+ProgressiveKeyListing::Private::~Private()
+{
+    state->canceled = true;
+}
+
+void ProgressiveKeyListing::Private::startListing(Protocol protocol)
+{
+    QThread *thread = QThread::create([protocol, state = state]() {
+        listKeys(protocol, state);
+    });
+    QObject::connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+    thread->start();
+}
+
+void ProgressiveKeyListing::Private::takeListedKeys()
+{
+    if (KeyCache::instance()->initialized()) {
+        // in case we missed the keyListingDone signal
+        addKeysFromKeyCache();
+        return;
+    }
+    std::vector<Key> keys;
+    {
+        const std::lock_guard lock{state->mutex};
+        keys.swap(state->keys);
+    }
+    if (!keys.empty()) {
+        pendingKeys.insert(pendingKeys.end(), keys.begin(), keys.end());
+        addPendingKeys();
+    }
+}
+
+void ProgressiveKeyListing::Private::addPendingKeys()
+{
+    addingScheduled = false;
+    if (pendingKeys.empty()) {
+        if (addingKeysFromKeyCache) {
+            finish();
+        }
+        return;
+    }
+    QElapsedTimer timer;
+    timer.start();
+    auto it = pendingKeys.begin();
+    while (it != pendingKeys.end() && timer.elapsed() < maxMillisecondsPerSlice) {
+        const auto chunkEnd = it + std::min<std::ptrdiff_t>(keysPerChunk, pendingKeys.end() - it);
+        const std::vector<Key> chunk(it, chunkEnd);
+        for (const auto &model : models) {
+            if (model) {
+                // keys that are already in the model are updated
+                model->addKeys(chunk);
+            }
+        }
+        if (!addingKeysFromKeyCache) {
+            preliminaryKeys.insert(preliminaryKeys.end(), chunk.begin(), chunk.end());
+        }
+        it = chunkEnd;
+    }
+    const bool firstKeys = numAddedKeys == 0;
+    numAddedKeys += std::distance(pendingKeys.begin(), it);
+    pendingKeys.erase(pendingKeys.begin(), it);
+    if (firstKeys) {
+        Q_EMIT q->firstKeysAdded();
+    }
+    if (!pendingKeys.empty()) {
+        scheduleAddingPendingKeys();
+    } else if (addingKeysFromKeyCache) {
+        finish();
+    }
+}
+
+void ProgressiveKeyListing::Private::scheduleAddingPendingKeys()
+{
+    if (addingScheduled) {
+        return;
+    }
+    addingScheduled = true;
+    // continue as soon as the pending events have been processed
+    QTimer::singleShot(0, q, [this]() {
+        if (!finished) {
+            addPendingKeys();
+        }
+    });
+}
+
+void ProgressiveKeyListing::Private::addKeysFromKeyCache()
+{
+    if (addingKeysFromKeyCache) {
+        return;
+    }
+    addingKeysFromKeyCache = true;
+    state->canceled = true;
+    pollTimer.stop();
+
+    const auto cache = KeyCache::instance();
+    // remove the keys listed by us that the key cache doesn't know (anymore);
+    // all other keys are updated when the keys of the key cache are added
+    for (const auto &key : std::as_const(preliminaryKeys)) {
+        const Key cachedKey = cache->findByFingerprint(key.primaryFingerprint());
+        if (cachedKey.isNull() || (options == KeyList::SecretKeysOnly && !cachedKey.hasSecret())) {
+            for (const auto &model : models) {
+                if (model) {
+                    model->removeKey(key);
+                }
+            }
+        }
+    }
+    qCDebug(KLEOPATRA_LOG) << "ProgressiveKeyListing: Added" << preliminaryKeys.size() << "certificates before the key cache was initialized";
+    preliminaryKeys.clear();
+
+    // add the keys of the key cache in chunks like the keys listed by us
+    // instead of resetting the models with all keys at once
+    pendingKeys = options == KeyList::SecretKeysOnly ? cache->secretKeys() : cache->keys();
+    // if the key cache changes while we are adding its keys, then our keys
+    // are outdated
+    keyCacheConnection = QObject::connect(cache.get(), &KeyCache::keysMayHaveChanged, q, [this]() {
+        switchModelsToKeyCache();
+    });
+    addPendingKeys();
+}
+
+void ProgressiveKeyListing::Private::finish()
+{
+    if (finished) {
+        return;
+    }
+    finished = true;
+    pendingKeys.clear();
+    qCDebug(KLEOPATRA_LOG) << "ProgressiveKeyListing: Added all certificates of the key cache";
+    // the models update themselves with a reset on every change of the key
+    // cache when they use it; switching them now would reset them with the
+    // keys they already have, so we wait for the next change
+    Q_EMIT q->finished();
+}
+
+void ProgressiveKeyListing::Private::switchModelsToKeyCache()
+{
+    if (switchedToKeyCache) {
+        return;
+    }
+    switchedToKeyCache = true;
+    QObject::disconnect(keyCacheConnection);
+    for (const auto &model : models) {
+        if (model) {
+            model->useKeyCache(true, options);
+        }
+    }
+    finish();
+    q->deleteLater();
+}
+
+ProgressiveKeyListing::ProgressiveKeyListing(const std::vector<AbstractKeyListModel *> &models, KeyList::Options options, QObject *parent)
+    : QObject{parent}
+    , d{new Private{this, models, options}}
+{
+}
+
+ProgressiveKeyListing::~ProgressiveKeyListing() = default;
+
+void ProgressiveKeyListing::start()
+{
+    const auto cache = KeyCache::mutableInstance();
+    if (cache->initialized()) {
+        d->addKeysFromKeyCache();
+        return;
+    }
+    connect(cache.get(), &KeyCache::keyListingDone, this, [this]() {
+        d->addKeysFromKeyCache();
+    });
+    // the key cache lists the certificates independently of us
+    cache->startKeyListing();
+    d->startListing(GpgME::OpenPGP);
+    if (Settings{}.cmsEnabled()) {
+        d->startListing(GpgME::CMS);
+    }
+    d->pollTimer.start();
+}
+
+#include "moc_progressivekeylisting.cpp"
@@ -0,0 +1,64 @@
+/* -*- mode: c++; c-basic-offset:4 -*-
+    utils/progressivekeylisting.h
+
+    This file is part of Kleopatra, the KDE keymanager
+    SPDX-FileCopyrightText: 2024 g10 Code GmbH
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <Libkleo/KeyList>
+
+#include <QObject>
+
+#include <memory>
+#include <vector>
+
+namespace Kleo
+{
+class AbstractKeyListModel;
+
+/**
+ * Fills key list models progressively while the key cache is initialized.
+ *
+ * The key cache publishes the certificates only after the complete key
+ * listing is done, which takes a long time for big keyrings. Until then this
+ * class lists the first few hundred certificates (enough to fill the first
+ * screen) in worker threads and adds them to the models in small chunks, so
+ * that the first certificates are shown quickly and the event loop is never
+ * blocked for more than a few milliseconds. When the key cache has been
+ * initialized, its certificates are added to the models in the same way;
+ * certificates listed before that are updated or, if the key cache doesn't
+ * know them, removed. This keeps the selection and the scroll position.
+ *
+ * Resetting the models with the certificates they already have would block
+ * the event loop, so the models are switched to use the key cache only when
+ * it changes the next time. The object deletes itself after that.
+ */
+class ProgressiveKeyListing : public QObject
+{
+    Q_OBJECT
+public:
+    ProgressiveKeyListing(const std::vector<AbstractKeyListModel *> &models, KeyList::Options options, QObject *parent = nullptr);
+    ~ProgressiveKeyListing() override;
+
+    void start();
+
+Q_SIGNALS:
+    /**
+     * Emitted when the first certificates have been added to the models.
+     */
+    void firstKeysAdded();
+    /**
+     * Emitted when the models contain all certificates of the key cache.
+     */
+    void finished();
+
+private:
+    class Private;
+    const std::unique_ptr<Private> d;
+};
+
+}
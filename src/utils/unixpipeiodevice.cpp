@@ -0,0 +1,560 @@
+/* -*- mode: c++; c-basic-offset:4 -*-
+    utils/unixpipeiodevice.cpp
+
+    This file is part of Kleopatra, the KDE keymanager
+    SPDX-FileCopyrightText: 2024 g10 Code GmbH
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <config-kleopatra.h>
+
+#include "unixpipeiodevice.h"
+
+#include "kleopatra_debug.h"
+
+#include <QDeadlineTimer>
+#include <QMutex>
+#include <QSocketNotifier>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+using namespace Kleo;
+
+namespace
+{
+// the default size of the read buffer; this is also the maximum size of a
+// pipe buffer that an unprivileged process may set by default on Linux
+static const qint64 defaultBufferSize = 1024 * 1024;
+// reads of at least this size go directly into the caller's buffer if the
+// read buffer is empty
+static const qint64 directReadThreshold = 64 * 1024;
+
+static bool setFlags(int fd, int statusFlags, int descriptorFlags)
+{
+    const int oldStatusFlags = ::fcntl(fd, F_GETFL);
+    const int oldDescriptorFlags = ::fcntl(fd, F_GETFD);
+    return oldStatusFlags != -1 && oldDescriptorFlags != -1 //
+        && ::fcntl(fd, F_SETFL, oldStatusFlags | statusFlags) != -1 //
+        && ::fcntl(fd, F_SETFD, oldDescriptorFlags | descriptorFlags) != -1;
+}
+
+static void closeFd(int &fd)
+{
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+}
+
+class UnixPipeIODevice::Private
+{
+    friend class ::Kleo::UnixPipeIODevice;
+    UnixPipeIODevice *const q;
+
+public:
+    explicit Private(UnixPipeIODevice *qq)
+        : q(qq)
+    {
+    }
+
+private:
+    bool doOpen(int fd, OpenMode mode);
+    void doClose();
+
+    enum WaitResult {
+        Ready,
+        TimedOut,
+        Canceled,
+        Failed,
+    };
+    WaitResult waitForFd(short events, const QDeadlineTimer &deadline);
+    bool waitForData(const QDeadlineTimer &deadline);
+
+    // the following functions must be called with m_mutex locked
+    qint64 buffered() const
+    {
+        return m_end - m_begin;
+    }
+    bool done() const
+    {
+        return m_eof || m_errorCode != 0;
+    }
+    qint64 readFromFd(char *data, qint64 maxSize);
+    bool readIntoBuffer();
+    qint64 readAvailable(char *data, qint64 maxSize);
+
+    void readNotifierActivated();
+    void rearmReadNotifier();
+
+private:
+    int m_fd = -1;
+    int m_wakeFds[2] = {-1, -1};
+    qint64 m_bufferSize = defaultBufferSize;
+
+    // protects the read buffer and the EOF and error state; it's never held
+    // while waiting for the pipe
+    QMutex m_mutex;
+    QByteArray m_buffer;
+    qint64 m_begin = 0;
+    qint64 m_end = 0;
+    bool m_eof = false;
+    int m_errorCode = 0;
+
+    // held while a thread reads from or writes to the pipe, so that close()
+    // can wait for the thread to bail out before closing the pipe
+    QMutex m_ioMutex;
+    std::atomic<bool> m_closing = false;
+
+    QSocketNotifier *m_readNotifier = nullptr;
+    std::atomic<bool> m_readNotifierPaused = false;
+};
+
+bool UnixPipeIODevice::Private::doOpen(int fd, OpenMode mode)
+{
+    if (q->isOpen() || fd < 0) {
+        return false;
+    }
+    if (!(mode & ReadWrite)) {
+        return false; // need to have at least read -or- write
+    }
+
+    // the pipe is polled, so that close() can interrupt a blocked reader or writer
+    if (!setFlags(fd, O_NONBLOCK, 0)) {
+        qCDebug(KLEOPATRA_LOG) << __func__ << "Failed to make fd" << fd << "non-blocking:" << strerror(errno);
+        return false;
+    }
+    int wakeFds[2];
+    if (::pipe(wakeFds) != 0) {
+        return false;
+    }
+    if (!setFlags(wakeFds[0], O_NONBLOCK, FD_CLOEXEC) || !setFlags(wakeFds[1], O_NONBLOCK, FD_CLOEXEC)) {
+        closeFd(wakeFds[0]);
+        closeFd(wakeFds[1]);
+        return false;
+    }
+
+#if defined(F_GETPIPE_SZ) && defined(F_SETPIPE_SZ)
+    // let the kernel buffer as much data as we do; this fails harmlessly if
+    // the size exceeds what we are allowed to set
+    const int pipeSize = static_cast<int>(std::min<qint64>(m_bufferSize, INT_MAX));
+    if (::fcntl(fd, F_GETPIPE_SZ) < pipeSize) {
+        (void)::fcntl(fd, F_SETPIPE_SZ, pipeSize);
+    }
+#endif
+
+    m_fd = fd;
+    m_wakeFds[0] = wakeFds[0];
+    m_wakeFds[1] = wakeFds[1];
+    m_begin = m_end = 0;
+    m_eof = false;
+    m_errorCode = 0;
+    m_closing = false;
+
+    if (mode & ReadOnly) {
+        m_readNotifier = new QSocketNotifier(fd, QSocketNotifier::Read, q);
+        QObject::connect(m_readNotifier, &QSocketNotifier::activated, q, [this]() {
+            readNotifierActivated();
+        });
+    }
+
+    q->setOpenMode(mode | Unbuffered);
+    return true;
+}
+
+void UnixPipeIODevice::Private::doClose()
+{
+    // wake up a thread that is blocked in poll()
+    m_closing = true;
+    const char c = 0;
+    while (::write(m_wakeFds[1], &c, 1) == -1 && errno == EINTR) { }
+
+    delete m_readNotifier;
+    m_readNotifier = nullptr;
+    m_readNotifierPaused = false;
+
+    const QMutexLocker ioLocker(&m_ioMutex);
+    const QMutexLocker locker(&m_mutex);
+    closeFd(m_fd);
+    closeFd(m_wakeFds[0]);
+    closeFd(m_wakeFds[1]);
+    m_buffer.clear();
+    m_begin = m_end = 0;
+}
+
+UnixPipeIODevice::Private::WaitResult UnixPipeIODevice::Private::waitForFd(short events, const QDeadlineTimer &deadline)
+{
+    pollfd fds[2] = {
+        {m_fd, events, 0},
+        {m_wakeFds[0], POLLIN, 0},
+    };
+    while (true) {
+        if (m_closing) {
+            return Canceled;
+        }
+        const qint64 remaining = deadline.remainingTime();
+        const int timeout = remaining < 0 ? -1 : static_cast<int>(std::min<qint64>(remaining, INT_MAX));
+        const int result = ::poll(fds, 2, timeout);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return Failed;
+        }
+        if (result == 0) {
+            return TimedOut;
+        }
+        if (fds[1].revents) {
+            return Canceled;
+        }
+        // also on POLLHUP or POLLERR; the following read or write reports it
+        return Ready;
+    }
+}
+
+bool UnixPipeIODevice::Private::waitForData(const QDeadlineTimer &deadline)
+{
+    while (true) {
+        {
+            const QMutexLocker locker(&m_mutex);
+            if (buffered() > 0 || readIntoBuffer()) {
+                return true;
+            }
+            if (done()) {
+                return false;
+            }
+        }
+        if (waitForFd(POLLIN, deadline) != Ready) {
+            return false;
+        }
+    }
+}
+
+qint64 UnixPipeIODevice::Private::readFromFd(char *data, qint64 maxSize)
+{
+    if (m_fd < 0 || !(q->openMode() & ReadOnly) || done()) {
+        return 0;
+    }
+    ssize_t numRead;
+    do {
+        numRead = ::read(m_fd, data, maxSize);
+    } while (numRead == -1 && errno == EINTR);
+    if (numRead > 0) {
+        return numRead;
+    }
+    if (numRead == 0) {
+        m_eof = true;
+    } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        m_errorCode = errno;
+    }
+    return 0;
+}
+
+bool UnixPipeIODevice::Private::readIntoBuffer()
+{
+    if (m_fd < 0 || !(q->openMode() & ReadOnly) || done()) {
+        return false;
+    }
+    if (m_begin == m_end) {
+        m_begin = m_end = 0;
+    } else if (m_end == m_buffer.size() && m_begin > 0) {
+        std::memmove(m_buffer.data(), m_buffer.constData() + m_begin, buffered());
+        m_end -= m_begin;
+        m_begin = 0;
+    }
+    if (m_buffer.size() < m_bufferSize) {
+        // the buffer is allocated on first use
+        m_buffer.resize(m_bufferSize);
+    }
+    if (m_end == m_buffer.size()) {
+        return false;
+    }
+    const qint64 numRead = readFromFd(m_buffer.data() + m_end, m_buffer.size() - m_end);
+    m_end += numRead;
+    return numRead > 0;
+}
+
+qint64 UnixPipeIODevice::Private::readAvailable(char *data, qint64 maxSize)
+{
+    if (buffered() == 0) {
+        if (maxSize >= directReadThreshold) {
+            // avoid copying the data through the read buffer
+            return readFromFd(data, maxSize);
+        }
+        readIntoBuffer();
+    }
+    const qint64 numRead = std::min(maxSize, buffered());
+    std::memcpy(data, m_buffer.constData() + m_begin, numRead);
+    m_begin += numRead;
+    return numRead;
+}
+
+void UnixPipeIODevice::Private::readNotifierActivated()
+{
+    // don't get notified again until the consumer has read from the device
+    m_readNotifier->setEnabled(false);
+    m_readNotifierPaused = true;
+    Q_EMIT q->readyRead();
+}
+
+void UnixPipeIODevice::Private::rearmReadNotifier()
+{
+    if (!m_readNotifierPaused.exchange(false)) {
+        return;
+    }
+    // the consumer may read in a different thread than the one the notifier lives in
+    QMetaObject::invokeMethod(
+        q,
+        [this]() {
+            if (!m_readNotifier) {
+                return;
+            }
+            bool haveBufferedData;
+            bool isDone;
+            {
+                const QMutexLocker locker(&m_mutex);
+                haveBufferedData = buffered() > 0;
+                isDone = done();
+            }
+            if (haveBufferedData) {
+                m_readNotifierPaused = true;
+                Q_EMIT q->readyRead();
+            } else if (!isDone) {
+                m_readNotifier->setEnabled(true);
+            }
+        },
+        Qt::QueuedConnection);
+}
+
+UnixPipeIODevice::UnixPipeIODevice(QObject *parent)
+    : QIODevice(parent)
+    , d(new Private(this))
+{
+}
+
+UnixPipeIODevice::UnixPipeIODevice(int fd, OpenMode mode, QObject *parent)
+    : QIODevice(parent)
+    , d(new Private(this))
+{
+    open(fd, mode);
+}
+
+UnixPipeIODevice::~UnixPipeIODevice()
+{
+    if (isOpen()) {
+        close();
+    }
+}
+
+void UnixPipeIODevice::setBufferSize(qint64 size)
+{
+    Q_ASSERT(!isOpen());
+    d->m_bufferSize = std::max<qint64>(size, 1);
+}
+
+qint64 UnixPipeIODevice::bufferSize() const
+{
+    return d->m_bufferSize;
+}
+
+bool UnixPipeIODevice::open(int fd, OpenMode mode)
+{
+    return d->doOpen(fd, mode);
+}
+
+int UnixPipeIODevice::descriptor() const
+{
+    return d->m_fd;
+}
+
+qint64 UnixPipeIODevice::bytesAvailable() const
+{
+    const qint64 base = QIODevice::bytesAvailable();
+    const QMutexLocker locker(&d->m_mutex);
+    int inPipe = 0;
+    if (d->m_fd < 0 || !(openMode() & ReadOnly) || ::ioctl(d->m_fd, FIONREAD, &inPipe) != 0) {
+        inPipe = 0;
+    }
+    return base + d->buffered() + inPipe;
+}
+
+qint64 UnixPipeIODevice::bytesToWrite() const
+{
+    // all data is written synchronously
+    return QIODevice::bytesToWrite();
+}
+
+bool UnixPipeIODevice::canReadLine() const
+{
+    if (QIODevice::canReadLine()) {
+        return true;
+    }
+    const QMutexLocker locker(&d->m_mutex);
+    // only scan the data that hasn't been scanned yet after reading more
+    qint64 scanned = 0;
+    do {
+        if (std::memchr(d->m_buffer.constData() + d->m_begin + scanned, '\n', d->buffered() - scanned)) {
+            return true;
+        }
+        scanned = d->buffered();
+    } while (d->readIntoBuffer());
+    return false;
+}
+
+void UnixPipeIODevice::close()
+{
+    if (!isOpen()) {
+        return;
+    }
+
+    // tell clients we're about to close:
+    Q_EMIT aboutToClose();
+    d->doClose();
+
+    setOpenMode(NotOpen);
+}
+
+bool UnixPipeIODevice::isSequential() const
+{
+    return true;
+}
+
+bool UnixPipeIODevice::atEnd() const
+{
+    if (!QIODevice::atEnd()) {
+        return false;
+    }
+    if (!isOpen()) {
+        return true;
+    }
+    const QMutexLocker locker(&d->m_mutex);
+    if (d->buffered() == 0) {
+        d->readIntoBuffer();
+    }
+    return d->buffered() == 0 && d->done();
+}
+
+bool UnixPipeIODevice::waitForBytesWritten(int msecs)
+{
+    Q_UNUSED(msecs)
+    // all data is written synchronously
+    return d->m_fd >= 0;
+}
+
+bool UnixPipeIODevice::waitForReadyRead(int msecs)
+{
+    const QMutexLocker ioLocker(&d->m_ioMutex);
+    return d->waitForData(QDeadlineTimer(msecs));
+}
+
+qint64 UnixPipeIODevice::readData(char *data, qint64 maxSize)
+{
+    Q_ASSERT(data || maxSize == 0);
+    if (maxSize <= 0) {
+        return 0;
+    }
+
+    const QMutexLocker ioLocker(&d->m_ioMutex);
+    qint64 result = 0;
+    while (true) {
+        {
+            const QMutexLocker locker(&d->m_mutex);
+            result = d->readAvailable(data, maxSize);
+            if (result > 0) {
+                break;
+            }
+            if (d->done()) {
+                if (d->m_errorCode) {
+                    setErrorString(qt_error_string(d->m_errorCode));
+                    result = -1;
+                }
+                break;
+            }
+        }
+        const Private::WaitResult waitResult = d->waitForFd(POLLIN, QDeadlineTimer::Forever);
+        if (waitResult != Private::Ready) {
+            // report a canceled read as EOF
+            result = waitResult == Private::Failed ? -1 : 0;
+            break;
+        }
+    }
+    d->rearmReadNotifier();
+    return result;
+}
+
+qint64 UnixPipeIODevice::readLineData(char *data, qint64 maxSize)
+{
+    const QMutexLocker ioLocker(&d->m_ioMutex);
+    qint64 total = 0;
+    bool failed = false;
+    while (total < maxSize) {
+        {
+            const QMutexLocker locker(&d->m_mutex);
+            if (d->buffered() > 0 || d->readIntoBuffer()) {
+                const char *const begin = d->m_buffer.constData() + d->m_begin;
+                const qint64 available = std::min(maxSize - total, d->buffered());
+                const auto newline = static_cast<const char *>(std::memchr(begin, '\n', available));
+                const qint64 length = newline ? newline - begin + 1 : available;
+                std::memcpy(data + total, begin, length);
+                d->m_begin += length;
+                total += length;
+                if (newline) {
+                    break;
+                }
+                continue;
+            }
+            if (d->done()) {
+                failed = d->m_errorCode != 0;
+                break;
+            }
+        }
+        if (d->waitForFd(POLLIN, QDeadlineTimer::Forever) != Private::Ready) {
+            break;
+        }
+    }
+    d->rearmReadNotifier();
+    return (total > 0 || !failed) ? total : -1;
+}
+
+qint64 UnixPipeIODevice::writeData(const char *data, qint64 size)
+{
+    Q_ASSERT(data || size == 0);
+
+    const QMutexLocker ioLocker(&d->m_ioMutex);
+    qint64 totalWritten = 0;
+    while (totalWritten < size) {
+        // write directly from the caller's buffer
+        const ssize_t numWritten = ::write(d->m_fd, data + totalWritten, size - totalWritten);
+        if (numWritten > 0) {
+            totalWritten += numWritten;
+            continue;
+        }
+        if (numWritten == -1 && errno == EINTR) {
+            continue;
+        }
+        if (numWritten == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (d->waitForFd(POLLOUT, QDeadlineTimer::Forever) == Private::Ready) {
+                continue;
+            }
+            break;
+        }
+        setErrorString(qt_error_string(errno));
+        break;
+    }
+    if (totalWritten > 0) {
+        Q_EMIT bytesWritten(totalWritten);
+    }
+    return (totalWritten > 0 || size == 0) ? totalWritten : -1;
+}
+
+#include "moc_unixpipeiodevice.cpp"
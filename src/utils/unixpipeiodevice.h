@@ -0,0 +1,73 @@
+/* -*- mode: c++; c-basic-offset:4 -*-
+    utils/unixpipeiodevice.h
+
+    This file is part of Kleopatra, the KDE keymanager
+    SPDX-FileCopyrightText: 2024 g10 Code GmbH
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <QIODevice>
+
+#include <memory>
+
+namespace Kleo
+{
+
+/**
+ * A QIODevice for one end of a pipe on Unix-like systems.
+ *
+ * In contrast to KDPipeIODevice this device doesn't use helper threads.
+ * Reads and writes are done directly on the (non-blocking) file descriptor
+ * in the calling thread, which may be a different thread than the one the
+ * device lives in. Large reads go directly into the caller's buffer and
+ * writes are done directly from the caller's data; smaller reads are served
+ * from a large internal buffer. readyRead() is emitted in the thread of the
+ * device when the pipe becomes readable.
+ *
+ * Reading and writing block until data is available resp. all data has been
+ * written, or until the device is closed.
+ */
+class UnixPipeIODevice : public QIODevice
+{
+    Q_OBJECT
+public:
+    explicit UnixPipeIODevice(QObject *parent = nullptr);
+    explicit UnixPipeIODevice(int fd, OpenMode = ReadOnly, QObject *parent = nullptr);
+    ~UnixPipeIODevice() override;
+
+    /**
+     * Sets the size of the internal read buffer. The kernel's pipe buffer
+     * is enlarged to this size as far as the system permits. Must be called
+     * before the device is opened.
+     */
+    void setBufferSize(qint64 size);
+    qint64 bufferSize() const;
+
+    bool open(int fd, OpenMode mode = ReadOnly);
+
+    int descriptor() const;
+
+    qint64 bytesAvailable() const override;
+    qint64 bytesToWrite() const override;
+    bool canReadLine() const override;
+    void close() override;
+    bool isSequential() const override;
+    bool atEnd() const override;
+
+    bool waitForBytesWritten(int msecs) override;
+    bool waitForReadyRead(int msecs) override;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 readLineData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 size) override;
+
+private:
+    class Private;
+    const std::unique_ptr<Private> d;
+};
+
+}
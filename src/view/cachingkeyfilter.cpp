@@ -0,0 +1,159 @@
+/* -*- mode: c++; c-basic-offset:4 -*-
+    view/cachingkeyfilter.cpp
+
+    This file is part of Kleopatra, the KDE keymanager
+    SPDX-FileCopyrightText: 2024 g10 Code GmbH
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <config-kleopatra.h>
+
+#include "cachingkeyfilter.h"
+
+#include <Libkleo/KeyCache>
+
+#include <gpgme++/key.h>
+
+#include <map>
+#include <optional>
+#include <string>
+#include <utility>
+
+using namespace Kleo;
+using namespace GpgME;
+
+namespace
+{
+// the results of the key filters by filter id and fingerprint
+class KeyFilterResultCache
+{
+public:
+    static KeyFilterResultCache &instance()
+    {
+        static KeyFilterResultCache cache;
+        return cache;
+    }
+
+    std::optional<bool> result(const KeyFilter *filter, const Key &key, KeyFilter::MatchContexts contexts) const
+    {
+        const auto it = m_results.find(filter->id());
+        if (it == m_results.end() || it->second.filter != filter) {
+            return std::nullopt;
+        }
+        const auto resultIt = it->second.results.find({key.primaryFingerprint(), contexts.toInt()});
+        if (resultIt == it->second.results.end() || resultIt->second.key.impl() != key.impl()) {
+            return std::nullopt;
+        }
+        return resultIt->second.matches;
+    }
+
+    void setResult(const KeyFilter *filter, const Key &key, KeyFilter::MatchContexts contexts, bool matches)
+    {
+        auto &filterResults = m_results[filter->id()];
+        if (filterResults.filter != filter) {
+            // the key filters have been reloaded
+            filterResults.filter = filter;
+            filterResults.results.clear();
+        }
+        filterResults.results.insert_or_assign({key.primaryFingerprint(), contexts.toInt()}, Result{key, matches});
+    }
+
+private:
+    KeyFilterResultCache()
+    {
+        const auto cache = KeyCache::instance();
+        QObject::connect(cache.get(), &KeyCache::keysMayHaveChanged, cache.get(), [this]() {
+            m_results.clear();
+        });
+    }
+
+    struct Result {
+        // keeps the key data alive, so that its address isn't reused for another key
+        Key key;
+        bool matches;
+    };
+    struct FilterResults {
+        const KeyFilter *filter = nullptr;
+        std::map<std::pair<std::string, int>, Result> results;
+    };
+    std::map<QString, FilterResults> m_results;
+};
+}
+
+CachingKeyFilter::CachingKeyFilter(const std::shared_ptr<KeyFilter> &filter)
+    : DefaultKeyFilter()
+    , m_filter{filter}
+{
+    Q_ASSERT(m_filter);
+}
+
+CachingKeyFilter::~CachingKeyFilter() = default;
+
+// static
+std::shared_ptr<KeyFilter> CachingKeyFilter::decorate(const std::shared_ptr<KeyFilter> &filter)
+{
+    if (!filter || std::dynamic_pointer_cast<CachingKeyFilter>(filter)) {
+        return filter;
+    }
+    return std::make_shared<CachingKeyFilter>(filter);
+}
+
+bool CachingKeyFilter::matches(const Key &key, MatchContexts contexts) const
+{
+    if (key.isNull() || !key.primaryFingerprint()) {
+        return m_filter->matches(key, contexts);
+    }
+    auto &cache = KeyFilterResultCache::instance();
+    if (const auto result = cache.result(m_filter.get(), key, contexts)) {
+        return *result;
+    }
+    const bool result = m_filter->matches(key, contexts);
+    cache.setResult(m_filter.get(), key, contexts, result);
+    return result;
+}
+
+bool CachingKeyFilter::matches(const UserID &userID, MatchContexts contexts) const
+{
+    return m_filter->matches(userID, contexts);
+}
+
+unsigned int CachingKeyFilter::specificity() const
+{
+    return m_filter->specificity();
+}
+
+QString CachingKeyFilter::id() const
+{
+    return m_filter->id();
+}
+
+KeyFilter::MatchContexts CachingKeyFilter::availableMatchContexts() const
+{
+    return m_filter->availableMatchContexts();
+}
+
+QColor CachingKeyFilter::fgColor() const
+{
+    return m_filter->fgColor();
+}
+
+QColor CachingKeyFilter::bgColor() const
+{
+    return m_filter->bgColor();
+}
+
+KeyFilter::FontDescription CachingKeyFilter::fontDescription() const
+{
+    return m_filter->fontDescription();
+}
+
+QString CachingKeyFilter::name() const
+{
+    return m_filter->name();
+}
+
+QString CachingKeyFilter::icon() const
+{
+    return m_filter->icon();
+}
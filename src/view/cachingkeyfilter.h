@@ -0,0 +1,61 @@
+/* -*- mode: c++; c-basic-offset:4 -*-
+    view/cachingkeyfilter.h
+
+    This file is part of Kleopatra, the KDE keymanager
+    SPDX-FileCopyrightText: 2024 g10 Code GmbH
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <Libkleo/DefaultKeyFilter>
+
+#include <memory>
+
+namespace Kleo
+{
+
+/**
+ * A key filter that remembers the results of another key filter.
+ *
+ * Evaluating a key filter for all certificates is expensive for big keyrings,
+ * and all views with the same key filter (e.g. several tabs of the certificate
+ * list) evaluate it for the same certificates. This decorator stores the
+ * result for each certificate in a cache that is shared by all decorators of
+ * key filters with the same id. A cached result is only used for the very
+ * same certificate object, i.e. refreshed certificates are filtered again.
+ * The cache is cleared when the keys of the key cache may have changed.
+ *
+ * Only the results for certificates are cached, not the results for user IDs.
+ */
+class CachingKeyFilter : public DefaultKeyFilter
+{
+public:
+    explicit CachingKeyFilter(const std::shared_ptr<KeyFilter> &filter);
+    ~CachingKeyFilter() override;
+
+    /**
+     * Returns a CachingKeyFilter for @p filter. Returns @p filter if it is
+     * null or already a CachingKeyFilter.
+     */
+    static std::shared_ptr<KeyFilter> decorate(const std::shared_ptr<KeyFilter> &filter);
+
+    bool matches(const GpgME::Key &key, MatchContexts contexts) const override;
+    bool matches(const GpgME::UserID &userID, MatchContexts contexts) const override;
+
+    unsigned int specificity() const override;
+    QString id() const override;
+    MatchContexts availableMatchContexts() const override;
+
+    QColor fgColor() const override;
+    QColor bgColor() const override;
+    FontDescription fontDescription() const override;
+    QString name() const override;
+    QString icon() const override;
+
+private:
+    const std::shared_ptr<KeyFilter> m_filter;
+};
+
+}
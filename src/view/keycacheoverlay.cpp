@@ -18,6 +18,8 @@
 #include <QEvent>
 #include <QVBoxLayout>
 
+#include <algorithm>
+
 using namespace Kleo;
 using namespace Qt::Literals::StringLiterals;
 
@@ -35,11 +37,11 @@ KeyCacheOverlay::KeyCacheOverlay(QWidget *baseWidget, QWidget *parent)
 
     auto vLay = new QVBoxLayout(this);
 
-    auto waitWidget = new WaitWidget(this);
+    mWaitWidget = new WaitWidget(this);
 
-    waitWidget->setText("<h3>"_L1 + i18n("Loading certificate cache...") + "</h3>"_L1);
+    mWaitWidget->setText("<h3>"_L1 + i18n("Loading certificate cache...") + "</h3>"_L1);
 
-    vLay->addWidget(waitWidget);
+    vLay->addWidget(mWaitWidget);
 
     mBaseWidget->installEventFilter(this);
     mBaseWidget->setEnabled(false);
@@ -49,7 +51,8 @@ KeyCacheOverlay::KeyCacheOverlay(QWidget *baseWidget, QWidget *parent)
         // To avoid an infinite show if we miss the keyListingDone signal
         // (Race potential) we use a watchdog timer, too to actively poll
         // the keycache every second. See bug #381910
-        if (KeyCache::instance()->initialized()) {
+        // in banner mode we are hidden when the certificates have been added to the list
+        if (!mBanner && KeyCache::instance()->initialized()) {
             qCDebug(KLEOPATRA_LOG) << "Hiding overlay from watchdog";
             hideOverlay();
         }
@@ -57,7 +60,11 @@ KeyCacheOverlay::KeyCacheOverlay(QWidget *baseWidget, QWidget *parent)
 
     mTimer.start(1000);
 
-    connect(cache.get(), &KeyCache::keyListingDone, this, &KeyCacheOverlay::hideOverlay);
+    connect(cache.get(), &KeyCache::keyListingDone, this, [this]() {
+        if (!mBanner) {
+            hideOverlay();
+        }
+    });
 }
 
 bool KeyCacheOverlay::eventFilter(QObject *object, QEvent *event)
@@ -78,6 +85,14 @@ void KeyCacheOverlay::reposition()
         show();
     }
 
+    if (mBanner) {
+        const int height = std::min(sizeHint().height(), mBaseWidget->height());
+        const QPoint topLevelPos = mBaseWidget->mapTo(window(), QPoint(0, mBaseWidget->height() - height));
+        move(parentWidget()->mapFrom(window(), topLevelPos));
+        resize(mBaseWidget->width(), height);
+        return;
+    }
+
     const QPoint topLevelPos = mBaseWidget->mapTo(window(), QPoint(0, 0));
     const QPoint parentPos = parentWidget()->mapFrom(window(), topLevelPos);
     move(parentPos);
@@ -94,4 +109,17 @@ void KeyCacheOverlay::hideOverlay()
     deleteLater();
 }
 
+void KeyCacheOverlay::showAsBanner()
+{
+    if (mBanner || KeyCache::instance()->initialized()) {
+        return;
+    }
+    mBanner = true;
+    mWaitWidget->setText(i18n("Loading the remaining certificates..."));
+    // don't let the certificates shine through the banner
+    setAutoFillBackground(true);
+    // the base widget stays disabled because the list is still incomplete
+    reposition();
+}
+
 #include "moc_keycacheoverlay.cpp"
@@ -13,6 +13,7 @@
 
 namespace Kleo
 {
+class WaitWidget;
 
 /**
  * @internal
@@ -30,19 +31,30 @@ public:
      */
     explicit KeyCacheOverlay(QWidget *baseWidget, QWidget *parent = nullptr);
 
+public Q_SLOTS:
+    /** Hides the overlay and triggers deletion. */
+    void hideOverlay();
+
+    /**
+     * Unblocks the base widget and shrinks the overlay to a banner at the
+     * bottom of it, e.g. if the first certificates are already shown. The
+     * base widget stays disabled. Other than the overlay, the banner is not
+     * hidden automatically when the key cache has been initialized; call
+     * hideOverlay() when the list is complete.
+     */
+    void showAsBanner();
+
 protected:
     bool eventFilter(QObject *object, QEvent *event) override;
 
 private:
     void reposition();
 
-private Q_SLOTS:
-    /** Hides the overlay and triggers deletion. */
-    void hideOverlay();
-
 private:
     QWidget *mBaseWidget;
+    WaitWidget *mWaitWidget = nullptr;
     QTimer mTimer;
+    bool mBanner = false;
 };
 
 } // namespace Kleo
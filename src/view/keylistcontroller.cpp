@@ -76,7 +76,10 @@
 #include <QPointer>
 
 #include <algorithm>
+#include <array>
+#include <bitset>
 #include <iterator>
+#include <unordered_map>
 
 using namespace Kleo;
 using namespace Kleo::Commands;
@@ -85,6 +88,92 @@ using namespace GpgME;
 
 namespace ranges = std::ranges;
 
+namespace
+{
+// the properties of a single key that the restrictions of the commands
+// depend on; a restriction is satisfied if all selected keys have the
+// corresponding trait
+enum KeyTrait {
+    PrimaryKeyIsSecret,
+    HasSecretSubkeyData,
+    HasSecretPrimaryKeyData,
+    IsOpenPGP,
+    IsCMS,
+    IsValid,
+    IsNotUltimatelyTrustedSecretKey,
+    IsRoot,
+    IsTrustedRoot,
+    IsSuitableForCard,
+    NumKeyTraits,
+};
+using KeyTraits = std::bitset<NumKeyTraits>;
+
+KeyTraits keyTraits(const Key &key);
+
+/**
+ * Counts how many of the selected keys have each trait. The counters are
+ * updated with the changes of the selection, so that the restrictions of a
+ * large selection don't have to be computed from scratch for every change.
+ */
+struct SelectionRestrictions {
+    bool valid = false;
+    qsizetype numKeys = 0;
+    std::array<qsizetype, NumKeyTraits> numKeysWithTrait = {};
+
+    void reset()
+    {
+        valid = true;
+        numKeys = 0;
+        numKeysWithTrait.fill(0);
+    }
+
+    void add(const KeyTraits &traits, qsizetype delta)
+    {
+        numKeys += delta;
+        for (int trait = 0; trait < NumKeyTraits; ++trait) {
+            if (traits.test(trait)) {
+                numKeysWithTrait[trait] += delta;
+            }
+        }
+    }
+
+    void add(const KeyListModelInterface *model, const QModelIndexList &rows)
+    {
+        for (const QModelIndex &index : rows) {
+            const Key key = model->key(index);
+            if (!key.isNull()) {
+                add(keyTraits(key), 1);
+            }
+        }
+    }
+
+    void add(const KeyListModelInterface *model, const QItemSelection &selection, qsizetype delta)
+    {
+        for (const QItemSelectionRange &range : selection) {
+            // count each row once, by its first column
+            if (range.left() != 0) {
+                continue;
+            }
+            for (int row = range.top(); row <= range.bottom(); ++row) {
+                const Key key = model->key(range.model()->index(row, 0, range.parent()));
+                if (!key.isNull()) {
+                    add(keyTraits(key), delta);
+                }
+            }
+        }
+    }
+
+    bool isConsistent() const
+    {
+        return numKeys >= 0 && ranges::all_of(numKeysWithTrait, [this](auto n) {
+                   return n >= 0 && n <= numKeys;
+               });
+    }
+
+    Command::Restrictions restrictions() const;
+};
+}
+
 class KeyListController::Private
 {
     friend class ::Kleo::KeyListController;
@@ -114,6 +203,10 @@ public:
     {
         view->disconnect(q);
         view->selectionModel()->disconnect(q);
+        if (view->selectionModel()->model()) {
+            view->selectionModel()->model()->disconnect(q);
+        }
+        selectionRestrictions.erase(view->selectionModel());
         std::erase(views, view);
     }
 
@@ -126,7 +219,7 @@ public:
     }
     void slotDoubleClicked(const QModelIndex &idx);
     void slotActivated(const QModelIndex &idx);
-    void slotSelectionChanged(const QItemSelection &old, const QItemSelection &new_);
+    void slotSelectionChanged(const QItemSelection &selected, const QItemSelection &deselected);
     void slotContextMenu(const QPoint &pos);
     void slotCommandFinished();
     void slotActionTriggered(QAction *action);
@@ -144,7 +237,8 @@ private:
     int toolTipOptions() const;
 
 private:
-    static Command::Restrictions calculateRestrictionsMask(const QItemSelectionModel *sm);
+    Command::Restrictions calculateRestrictionsMask(const QItemSelectionModel *sm);
+    void invalidateSelectionRestrictions(const QItemSelectionModel *sm);
 
 private:
     struct action_item {
@@ -160,6 +254,8 @@ private:
     QPointer<QAbstractItemView> currentView;
     QPointer<AbstractKeyListModel> flatModel, hierarchicalModel;
     std::vector<QMetaObject::Connection> m_connections;
+    std::unordered_map<const QItemSelectionModel *, SelectionRestrictions> selectionRestrictions;
+    bool selectionRestrictionsUpdateScheduled = false;
 };
 
 KeyListController::Private::Private(KeyListController *qq)
@@ -812,8 +908,33 @@ void KeyListController::Private::connectView(QAbstractItemView *view)
     connect(view, &QAbstractItemView::activated, q, [this](const QModelIndex &index) {
         slotActivated(index);
     });
-    connect(view->selectionModel(), &QItemSelectionModel::selectionChanged, q, [this](const QItemSelection &oldSel, const QItemSelection &newSel) {
-        slotSelectionChanged(oldSel, newSel);
+    connect(view->selectionModel(), &QItemSelectionModel::selectionChanged, q, [this](const QItemSelection &selected, const QItemSelection &deselected) {
+        slotSelectionChanged(selected, deselected);
+    });
+
+    // the selection changes are tracked incrementally; changes of the model
+    // (e.g. removed rows or updated keys) require a full recalculation
+    const QItemSelectionModel *const sm = view->selectionModel();
+    selectionRestrictions[sm];
+    connect(sm, &QObject::destroyed, q, [this, sm]() {
+        selectionRestrictions.erase(sm);
+    });
+    const auto connectModel = [this, sm](QAbstractItemModel *model) {
+        if (!model) {
+            return;
+        }
+        const auto invalidate = [this, sm]() {
+            invalidateSelectionRestrictions(sm);
+        };
+        connect(model, &QAbstractItemModel::rowsRemoved, q, invalidate);
+        connect(model, &QAbstractItemModel::modelReset, q, invalidate);
+        connect(model, &QAbstractItemModel::layoutChanged, q, invalidate);
+        connect(model, &QAbstractItemModel::dataChanged, q, invalidate);
+    };
+    connectModel(sm->model());
+    connect(sm, &QItemSelectionModel::modelChanged, q, [this, sm, connectModel](QAbstractItemModel *model) {
+        connectModel(model);
+        invalidateSelectionRestrictions(sm);
     });
 
     view->setContextMenuPolicy(Qt::CustomContextMenu);
@@ -860,18 +981,46 @@ void KeyListController::Private::slotActivated(const QModelIndex &idx)
     }
 }
 
-void KeyListController::Private::slotSelectionChanged(const QItemSelection &old, const QItemSelection &new_)
+void KeyListController::Private::slotSelectionChanged(const QItemSelection &selected, const QItemSelection &deselected)
 {
-    Q_UNUSED(old)
-    Q_UNUSED(new_)
-
     const QItemSelectionModel *const sm = qobject_cast<QItemSelectionModel *>(q->sender());
     if (!sm) {
         return;
     }
+    const auto it = selectionRestrictions.find(sm);
+    const auto *const m = dynamic_cast<const KeyListModelInterface *>(sm->model());
+    if (it != selectionRestrictions.end() && it->second.valid && m) {
+        it->second.add(m, deselected, -1);
+        it->second.add(m, selected, 1);
+        if (!it->second.isConsistent()) {
+            it->second.valid = false;
+        }
+    }
     q->enableDisableActions(sm);
 }
 
+void KeyListController::Private::invalidateSelectionRestrictions(const QItemSelectionModel *sm)
+{
+    const auto it = selectionRestrictions.find(sm);
+    if (it == selectionRestrictions.end() || !it->second.valid) {
+        return;
+    }
+    it->second.valid = false;
+    if (selectionRestrictionsUpdateScheduled) {
+        return;
+    }
+    // the selection model may still be updating; update the actions once
+    // the model has settled
+    selectionRestrictionsUpdateScheduled = true;
+    QMetaObject::invokeMethod(
+        q,
+        [this]() {
+            selectionRestrictionsUpdateScheduled = false;
+            q->enableDisableActions(currentView ? currentView->selectionModel() : nullptr);
+        },
+        Qt::QueuedConnection);
+}
+
 void KeyListController::Private::slotContextMenu(const QPoint &p)
 {
     QAbstractItemView *const view = qobject_cast<QAbstractItemView *>(q->sender());
@@ -903,108 +1052,133 @@ void KeyListController::enableDisableActions(const QItemSelectionModel *sm) cons
         }
 }
 
-static bool all_secret_are_not_owner_trust_ultimate(const std::vector<Key> &keys)
+static bool secretSubkeyDataAvailable(const Subkey &subkey)
 {
-    for (const Key &key : keys)
-        if (key.hasSecret() && key.ownerTrust() == Key::Ultimate) {
-            return false;
-        }
-    return true;
+    return subkey.isSecret() && !subkey.isCardKey();
 }
 
-Command::Restrictions find_root_restrictions(const std::vector<Key> &keys)
+static bool isSuitableForCard(const Key &key)
 {
-    bool trusted = false, untrusted = false;
-    for (const Key &key : keys)
-        if (key.isRoot())
-            if (key.userID(0).validity() == UserID::Ultimate) {
-                trusted = true;
-            } else {
-                untrusted = true;
-            }
-        else {
-            return Command::NoRestriction;
+    bool hasSignCertify = false;
+    bool hasEncrypt = false;
+    bool hasAuthenticate = false;
+    for (const auto &subkey : key.subkeys()) {
+        if (subkey.isCardKey()) {
+            return false;
         }
-    if (trusted)
-        if (untrusted) {
-            return Command::NoRestriction;
-        } else {
-            return Command::MustBeTrustedRoot;
+        if (subkey.canCertify() && subkey.canSign()) {
+            if (hasSignCertify) {
+                return false;
+            }
+            hasSignCertify = true;
+        } else if (subkey.canEncrypt()) {
+            if (hasEncrypt) {
+                return false;
+            }
+            hasEncrypt = true;
+        } else if (subkey.canAuthenticate()) {
+            if (hasAuthenticate) {
+                return false;
+            }
+            hasAuthenticate = true;
+        } else if (!subkey.canRenc()) { // we don't mind ADSKs
+            return false;
         }
-    else if (untrusted) {
-        return Command::MustBeUntrustedRoot;
-    } else {
-        return Command::NoRestriction;
     }
+    return hasSignCertify && hasEncrypt;
 }
 
-static bool secretSubkeyDataAvailable(const Subkey &subkey)
+namespace
 {
-    return subkey.isSecret() && !subkey.isCardKey();
+KeyTraits keyTraits(const Key &key)
+{
+    KeyTraits traits;
+    // we need to check the primary subkey because Key::hasSecret() is also true if just the secret key stub of an offline key is available
+    traits[PrimaryKeyIsSecret] = key.subkey(0).isSecret();
+    traits[HasSecretSubkeyData] = ranges::any_of(key.subkeys(), &secretSubkeyDataAvailable);
+    traits[HasSecretPrimaryKeyData] = secretSubkeyDataAvailable(key.subkey(0));
+    traits[IsOpenPGP] = key.protocol() == OpenPGP;
+    traits[IsCMS] = key.protocol() == CMS;
+    traits[IsValid] = !key.isBad();
+    traits[IsNotUltimatelyTrustedSecretKey] = !(key.hasSecret() && key.ownerTrust() == Key::Ultimate);
+    traits[IsRoot] = key.isRoot();
+    traits[IsTrustedRoot] = key.isRoot() && key.userID(0).validity() == UserID::Ultimate;
+    traits[IsSuitableForCard] = isSuitableForCard(key);
+    return traits;
 }
 
-Command::Restrictions KeyListController::Private::calculateRestrictionsMask(const QItemSelectionModel *sm)
+Command::Restrictions SelectionRestrictions::restrictions() const
 {
-    if (!sm) {
-        return Command::NoRestriction;
-    }
-
-    const KeyListModelInterface *const m = dynamic_cast<const KeyListModelInterface *>(sm->model());
-    if (!m) {
-        return Command::NoRestriction;
-    }
-
-    const std::vector<Key> keys = m->keys(sm->selectedRows());
-    if (keys.empty()) {
+    if (numKeys == 0) {
         return Command::NoRestriction;
     }
+    const auto all = [this](KeyTrait trait) {
+        return numKeysWithTrait[trait] == numKeys;
+    };
 
     Command::Restrictions result = Command::NeedSelection;
 
-    if (keys.size() == 1) {
+    if (numKeys == 1) {
         result |= Command::OnlyOneKey;
     }
-
-    // we need to check the primary subkey because Key::hasSecret() is also true if just the secret key stub of an offline key is available
-    const auto primaryKeyCanBeUsedForSecretKeyOperations = [](const auto &k) {
-        return k.subkey(0).isSecret();
-    };
-    if (ranges::all_of(keys, primaryKeyCanBeUsedForSecretKeyOperations)) {
+    if (all(PrimaryKeyIsSecret)) {
         result |= Command::NeedSecretKey;
     }
-
-    if (ranges::all_of(keys, [](const auto &k) {
-            return ranges::any_of(k.subkeys(), &secretSubkeyDataAvailable);
-        })) {
+    if (all(HasSecretSubkeyData)) {
         result |= Command::NeedSecretSubkeyData;
+        if (all(HasSecretPrimaryKeyData)) {
+            result |= Command::NeedSecretPrimaryKeyData;
+        }
     }
-    if ((result & Command::NeedSecretSubkeyData) && ranges::all_of(keys, [](const auto &k) {
-            return secretSubkeyDataAvailable(k.subkey(0));
-        })) {
-        result |= Command::NeedSecretPrimaryKeyData;
-    }
-
-    if (ranges::all_of(keys, [](const Key &key) {
-            return key.protocol() == OpenPGP;
-        })) {
+    if (all(IsOpenPGP)) {
         result |= Command::MustBeOpenPGP;
-    } else if (ranges::all_of(keys, [](const Key &key) {
-                   return key.protocol() == CMS;
-               })) {
+    } else if (all(IsCMS)) {
         result |= Command::MustBeCMS;
     }
-
-    if (ranges::all_of(keys, [](const auto &key) {
-            return !key.isBad();
-        })) {
+    if (all(IsValid)) {
         result |= Command::MustBeValid;
     }
-
-    if (all_secret_are_not_owner_trust_ultimate(keys)) {
+    if (all(IsNotUltimatelyTrustedSecretKey)) {
         result |= Command::MayOnlyBeSecretKeyIfOwnerTrustIsNotYetUltimate;
     }
+    if (all(IsRoot)) {
+        const qsizetype numTrusted = numKeysWithTrait[IsTrustedRoot];
+        if (numTrusted == numKeys) {
+            result |= Command::MustBeTrustedRoot;
+        } else if (numTrusted == 0) {
+            result |= Command::MustBeUntrustedRoot;
+        }
+    }
+    if (all(IsSuitableForCard)) {
+        result |= Command::SuitableForCard;
+    }
+    return result;
+}
+}
+
+Command::Restrictions KeyListController::Private::calculateRestrictionsMask(const QItemSelectionModel *sm)
+{
+    if (!sm) {
+        return Command::NoRestriction;
+    }
+
+    const KeyListModelInterface *const m = dynamic_cast<const KeyListModelInterface *>(sm->model());
+    if (!m) {
+        return Command::NoRestriction;
+    }
 
-    result |= find_root_restrictions(keys);
+    SelectionRestrictions untracked;
+    const auto it = selectionRestrictions.find(sm);
+    SelectionRestrictions &state = it != selectionRestrictions.end() ? it->second : untracked;
+    if (!state.valid) {
+        state.reset();
+        state.add(m, sm->selectedRows());
+    }
+
+    Command::Restrictions result = state.restrictions();
+    if (result == Command::NoRestriction) {
+        return result;
+    }
 
     if (const ReaderStatus *rs = ReaderStatus::instance()) {
         if (!rs->firstCardWithNullPin().empty()) {
@@ -1012,49 +1186,6 @@ Command::Restrictions KeyListController::Private::calculateRestrictionsMask(cons
         }
     }
 
-    {
-        if (keys.size() > 0) {
-            bool hasSignCertify = false;
-            bool hasEncrypt = false;
-            bool hasAuthenticate = false;
-            bool invalid = false;
-            for (const auto &subkey : keys[0].subkeys()) {
-                if (subkey.isCardKey()) {
-                    invalid = true;
-                    break;
-                }
-                if (subkey.canCertify() && subkey.canSign()) {
-                    if (hasSignCertify) {
-                        invalid = true;
-                        break;
-                    } else {
-                        hasSignCertify = true;
-                    }
-                } else if (subkey.canEncrypt()) {
-                    if (hasEncrypt) {
-                        invalid = true;
-                        break;
-                    } else {
-                        hasEncrypt = true;
-                    }
-                } else if (subkey.canAuthenticate()) {
-                    if (hasAuthenticate) {
-                        invalid = true;
-                        break;
-                    } else {
-                        hasAuthenticate = true;
-                    }
-                } else if (!subkey.canRenc()) { // we don't mind ADSKs
-                    invalid = true;
-                    break;
-                }
-            }
-            if (hasSignCertify && hasEncrypt && !invalid) {
-                result |= Command::SuitableForCard;
-            }
-        }
-    }
-
     return result;
 }
 
@@ -0,0 +1,201 @@
+/* -*- mode: c++; c-basic-offset:4 -*-
+    view/keysearchfilterproxymodel.cpp
+
+    This file is part of Kleopatra, the KDE keymanager
+    SPDX-FileCopyrightText: 2024 g10 Code GmbH
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <config-kleopatra.h>
+
+#include "keysearchfilterproxymodel.h"
+
+#include <utils/keysearchindex.h>
+
+#include <Libkleo/KeyGroup>
+#include <Libkleo/KeyList>
+
+#include <gpgme++/key.h>
+
+#include <QThread>
+#include <QTimer>
+
+#include <optional>
+#include <vector>
+
+using namespace Kleo;
+using namespace GpgME;
+
+namespace
+{
+// time to wait for further input before searching
+static const int searchDelayInMilliseconds = 200;
+}
+
+class KeySearchFilterProxyModel::Private
+{
+    friend class ::Kleo::KeySearchFilterProxyModel;
+    KeySearchFilterProxyModel *const q;
+
+public:
+    explicit Private(KeySearchFilterProxyModel *qq);
+
+private:
+    void setSearchText(const QString &text, bool debounce);
+    void startSearch();
+    void searchNow();
+    void apply(KeySearchResult &&result);
+    bool matches(const QModelIndex &index) const;
+
+private:
+    QString searchText;
+    // the normalized search text that shall be applied
+    QString needle;
+    QTimer searchTimer;
+    bool searching = false;
+    bool searchPending = false;
+
+    // the currently applied search
+    KeySearchResult applied;
+};
+
+KeySearchFilterProxyModel::Private::Private(KeySearchFilterProxyModel *qq)
+    : q{qq}
+{
+    searchTimer.setSingleShot(true);
+    searchTimer.setInterval(searchDelayInMilliseconds);
+    QObject::connect(&searchTimer, &QTimer::timeout, q, [this]() {
+        startSearch();
+    });
+    QObject::connect(KeySearchIndexProvider::instance(), &KeySearchIndexProvider::indexChanged, q, [this]() {
+        if (!needle.isEmpty() && !searchTimer.isActive()) {
+            startSearch();
+        }
+    });
+}
+
+void KeySearchFilterProxyModel::Private::setSearchText(const QString &text, bool debounce)
+{
+    if (text == searchText) {
+        return;
+    }
+    searchText = text;
+    const QString newNeedle = KeySearchIndex::normalizedSearchText(text);
+    if (newNeedle == needle) {
+        return;
+    }
+    needle = newNeedle;
+    if (needle.isEmpty()) {
+        searchTimer.stop();
+        apply({});
+    } else if (debounce) {
+        searchTimer.start();
+    } else {
+        searchTimer.stop();
+        searchNow();
+    }
+}
+
+void KeySearchFilterProxyModel::Private::startSearch()
+{
+    if (searching) {
+        searchPending = true;
+        return;
+    }
+    const auto index = KeySearchIndexProvider::instance()->index();
+    if (!index) {
+        // without index all rows are checked by filterAcceptsRow
+        apply({needle, nullptr, {}});
+        return;
+    }
+    std::optional<std::vector<std::size_t>> candidates;
+    if (applied.index() == index && !applied.needle().isEmpty() && needle.contains(applied.needle())) {
+        // the user continued typing; only the previous matches can still match
+        candidates = applied.entries();
+    }
+
+    searching = true;
+    auto entries = std::make_shared<std::vector<std::size_t>>();
+    QThread *thread = QThread::create([index, needle = needle, candidates = std::move(candidates), entries]() {
+        *entries = index->matches(needle, candidates ? &*candidates : nullptr);
+    });
+    QObject::connect(thread, &QThread::finished, q, [this, index, searchedNeedle = needle, entries]() {
+        searching = false;
+        if (searchedNeedle == needle && index == KeySearchIndexProvider::instance()->index()) {
+            apply({searchedNeedle, index, std::move(*entries)});
+        }
+        if (searchPending) {
+            searchPending = false;
+            startSearch();
+        }
+    });
+    QObject::connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+    thread->start();
+}
+
+void KeySearchFilterProxyModel::Private::searchNow()
+{
+    apply(KeySearchResult::search(needle));
+}
+
+void KeySearchFilterProxyModel::Private::apply(KeySearchResult &&result)
+{
+    applied = std::move(result);
+    q->invalidateFilter();
+}
+
+bool KeySearchFilterProxyModel::Private::matches(const QModelIndex &index) const
+{
+    const auto key = index.data(KeyList::KeyRole).value<Key>();
+    if (!key.isNull()) {
+        return applied.matches(key);
+    }
+    const auto group = index.data(KeyList::GroupRole).value<KeyGroup>();
+    if (!group.isNull()) {
+        return applied.matches(group);
+    }
+    return true;
+}
+
+KeySearchFilterProxyModel::KeySearchFilterProxyModel(QObject *parent)
+    : AbstractKeyListSortFilterProxyModel{parent}
+    , d{new Private{this}}
+{
+}
+
+KeySearchFilterProxyModel::~KeySearchFilterProxyModel() = default;
+
+KeySearchFilterProxyModel *KeySearchFilterProxyModel::clone() const
+{
+    auto model = new KeySearchFilterProxyModel{parent()};
+    model->setSearchText(d->searchText, false);
+    return model;
+}
+
+QString KeySearchFilterProxyModel::searchText() const
+{
+    return d->searchText;
+}
+
+void KeySearchFilterProxyModel::setSearchText(const QString &text, bool debounce)
+{
+    d->setSearchText(text, debounce);
+}
+
+bool KeySearchFilterProxyModel::filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const
+{
+    if (d->applied.needle().isEmpty()) {
+        return true;
+    }
+    const QModelIndex index = sourceModel()->index(sourceRow, 0, sourceParent);
+    // keep parents of matching children
+    for (int i = 0, end = sourceModel()->rowCount(index); i != end; ++i) {
+        if (filterAcceptsRow(i, index)) {
+            return true;
+        }
+    }
+    return d->matches(index);
+}
+
+#include "moc_keysearchfilterproxymodel.cpp"
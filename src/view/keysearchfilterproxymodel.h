@@ -0,0 +1,55 @@
+/* -*- mode: c++; c-basic-offset:4 -*-
+    view/keysearchfilterproxymodel.h
+
+    This file is part of Kleopatra, the KDE keymanager
+    SPDX-FileCopyrightText: 2024 g10 Code GmbH
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <Libkleo/KeyListSortFilterProxyModel>
+
+#include <memory>
+
+namespace Kleo
+{
+
+/**
+ * Filters a key list model by the search text entered by the user.
+ *
+ * Changes of the search text are debounced and the matching certificates
+ * are determined in a worker thread with the help of the shared search index
+ * (see KeySearchIndexProvider). If the user just continues typing, then only
+ * the certificates matching the previous search text are checked. Until the
+ * result is available the previous result stays visible.
+ */
+class KeySearchFilterProxyModel : public AbstractKeyListSortFilterProxyModel
+{
+    Q_OBJECT
+public:
+    explicit KeySearchFilterProxyModel(QObject *parent = nullptr);
+    ~KeySearchFilterProxyModel() override;
+
+    KeySearchFilterProxyModel *clone() const override;
+
+    QString searchText() const;
+
+public Q_SLOTS:
+    /**
+     * Sets the search text. An empty search text is applied immediately. If
+     * @p debounce is false, then the search is done synchronously, e.g. to
+     * apply the search text of a restored view without delay.
+     */
+    void setSearchText(const QString &text, bool debounce = true);
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const override;
+
+private:
+    class Private;
+    const std::unique_ptr<Private> d;
+};
+
+}
@@ -10,7 +10,10 @@
 #include <config-kleopatra.h>
 
 #include "keytreeview.h"
+#include "cachingkeyfilter.h"
+#include "keysearchfilterproxymodel.h"
 #include "searchbar.h"
+#include "sortkeycachingproxymodel.h"
 
 #include <Libkleo/KeyList>
 #include <Libkleo/KeyListModel>
@@ -105,7 +108,8 @@ const KeyListModelInterface *keyListModel(const QTreeView &view)
 
 KeyTreeView::KeyTreeView(QWidget *parent)
     : QWidget(parent)
-    , m_proxy(new KeyListSortFilterProxyModel(this))
+    , m_proxy(new SortKeyCachingProxyModel(this))
+    , m_searchProxy(new KeySearchFilterProxyModel(this))
     , m_additionalProxy(nullptr)
     , m_view(new TreeViewInternal(this))
     , m_flatModel(nullptr)
@@ -114,13 +118,16 @@ KeyTreeView::KeyTreeView(QWidget *parent)
     , m_keyFilter()
     , m_isHierarchical(true)
     , m_showDefaultContextMenu(true)
+    , m_cacheKeyFilterResults(false)
+    , m_stateRestoreScheduled(false)
 {
     init();
 }
 
 KeyTreeView::KeyTreeView(const KeyTreeView &other)
     : QWidget(nullptr)
-    , m_proxy(new KeyListSortFilterProxyModel(this))
+    , m_proxy(new SortKeyCachingProxyModel(this))
+    , m_searchProxy(new KeySearchFilterProxyModel(this))
     , m_additionalProxy(other.m_additionalProxy ? other.m_additionalProxy->clone() : nullptr)
     , m_view(new TreeViewInternal(this))
     , m_flatModel(other.m_flatModel)
@@ -130,6 +137,8 @@ KeyTreeView::KeyTreeView(const KeyTreeView &other)
     , m_group(other.m_group)
     , m_isHierarchical(other.m_isHierarchical)
     , m_showDefaultContextMenu(other.m_showDefaultContextMenu)
+    , m_cacheKeyFilterResults(other.m_cacheKeyFilterResults)
+    , m_stateRestoreScheduled(false)
 {
     init();
     setColumnSizes(other.columnSizes());
@@ -143,7 +152,8 @@ KeyTreeView::KeyTreeView(const QString &text,
                          const KConfigGroup &group,
                          Options options)
     : QWidget(parent)
-    , m_proxy(new KeyListSortFilterProxyModel(this))
+    , m_proxy(new SortKeyCachingProxyModel(this))
+    , m_searchProxy(new KeySearchFilterProxyModel(this))
     , m_additionalProxy(proxy)
     , m_view(new TreeViewInternal(this))
     , m_flatModel(nullptr)
@@ -154,6 +164,8 @@ KeyTreeView::KeyTreeView(const QString &text,
     , m_isHierarchical(true)
     , m_onceResized(false)
     , m_showDefaultContextMenu(!(options & Option::NoDefaultContextMenu))
+    , m_cacheKeyFilterResults(options.testFlag(Option::CacheKeyFilterResults))
+    , m_stateRestoreScheduled(false)
 {
     init();
 }
@@ -225,6 +237,7 @@ void KeyTreeView::restoreLayout(const KConfigGroup &group)
 void KeyTreeView::init()
 {
     Q_SET_OBJECT_NAME(m_proxy);
+    Q_SET_OBJECT_NAME(m_searchProxy);
     Q_SET_OBJECT_NAME(m_view);
 
     if (m_group.isValid()) {
@@ -275,18 +288,19 @@ void KeyTreeView::init()
         if (m_additionalProxy) {
             m_additionalProxy->setSourceModel(model());
         } else {
-            m_proxy->setSourceModel(model());
+            m_searchProxy->setSourceModel(model());
         }
     }
     if (m_additionalProxy) {
-        m_proxy->setSourceModel(m_additionalProxy);
+        m_searchProxy->setSourceModel(m_additionalProxy);
         if (!m_additionalProxy->parent()) {
             m_additionalProxy->setParent(this);
         }
     }
+    m_proxy->setSourceModel(m_searchProxy);
 
-    m_proxy->setFilterRegularExpression(QRegularExpression::escape(m_stringFilter.trimmed()));
-    m_proxy->setKeyFilter(m_keyFilter);
+    m_searchProxy->setSearchText(m_stringFilter, false);
+    m_proxy->setKeyFilter(proxyKeyFilter());
     m_proxy->setSortCaseSensitivity(Qt::CaseInsensitive);
 
     auto rearangingModel = new KeyRearrangeColumnsProxyModel(this);
@@ -465,7 +479,7 @@ void KeyTreeView::setStringFilter(const QString &filter)
         return;
     }
     m_stringFilter = filter;
-    m_proxy->setFilterRegularExpression(QRegularExpression::escape(filter.trimmed()));
+    m_searchProxy->setSearchText(filter);
     Q_EMIT stringFilterChanged(filter);
 }
 
@@ -475,21 +489,47 @@ void KeyTreeView::setKeyFilter(const std::shared_ptr<KeyFilter> &filter)
         return;
     }
     m_keyFilter = filter;
-    m_proxy->setKeyFilter(filter);
+    m_proxy->setKeyFilter(proxyKeyFilter());
     Q_EMIT keyFilterChanged(filter);
 }
 
+std::shared_ptr<KeyFilter> KeyTreeView::proxyKeyFilter() const
+{
+    // the key filter itself is kept undecorated because KeyFilterManager
+    // identifies the key filters by address
+    return m_cacheKeyFilterResults ? CachingKeyFilter::decorate(m_keyFilter) : m_keyFilter;
+}
+
 namespace
 {
 QItemSelection itemSelectionFromKeys(const std::vector<Key> &keys, const QTreeView &view)
 {
     const QModelIndexList indexes = keyListModel(view)->indexes(keys);
-    return std::accumulate(indexes.cbegin(), indexes.cend(), QItemSelection(), [](QItemSelection selection, const QModelIndex &index) {
+    // group the indexes by parent and row, so that adjacent rows can be
+    // combined to a single range; merging single indexes one by one into the
+    // selection is quadratic in the number of indexes
+    std::vector<std::pair<QModelIndex, QModelIndex>> indexesWithParent;
+    indexesWithParent.reserve(indexes.size());
+    for (const QModelIndex &index : indexes) {
         if (index.isValid()) {
-            selection.merge(QItemSelection(index, index), QItemSelectionModel::Select);
+            indexesWithParent.emplace_back(index.parent(), index);
         }
-        return selection;
+    }
+    std::sort(indexesWithParent.begin(), indexesWithParent.end(), [](const auto &lhs, const auto &rhs) {
+        return lhs.first != rhs.first ? lhs.first < rhs.first : lhs.second.row() < rhs.second.row();
     });
+
+    QItemSelection selection;
+    for (auto it = indexesWithParent.cbegin(); it != indexesWithParent.cend();) {
+        const QModelIndex &parent = it->first;
+        const QModelIndex &first = it->second;
+        QModelIndex last = first;
+        for (++it; it != indexesWithParent.cend() && it->first == parent && it->second.row() <= last.row() + 1; ++it) {
+            last = it->second;
+        }
+        selection.push_back(QItemSelectionRange{first, last});
+    }
+    return selection;
 }
 }
 
@@ -656,22 +696,53 @@ void KeyTreeView::initializeColumnSizes()
 
 void KeyTreeView::saveStateBeforeModelChange()
 {
+    if (m_stateRestoreScheduled) {
+        // keep the state from before the first of several changes
+        return;
+    }
     m_currentKey = keyListModel(*m_view)->key(m_view->currentIndex());
     m_selectedKeys = selectedKeys();
 }
 
 void KeyTreeView::restoreStateAfterModelChange()
+{
+    // remember the selection as the model change left it, so that we can tell
+    // whether somebody else changed the selection before we restore the state
+    m_selectionAfterModelChange = m_view->selectionModel()->selection();
+
+    // models often report changes in many small batches (e.g. while
+    // importing certificates); restore the state only once for all of them
+    if (m_stateRestoreScheduled) {
+        return;
+    }
+    m_stateRestoreScheduled = true;
+    QMetaObject::invokeMethod(
+        this,
+        [this]() {
+            m_stateRestoreScheduled = false;
+            restoreState();
+        },
+        Qt::QueuedConnection);
+}
+
+void KeyTreeView::restoreState()
 {
     restoreExpandState();
 
-    selectKeys(m_selectedKeys);
-    if (!m_currentKey.isNull()) {
-        const QModelIndex currentIndex = keyListModel(*m_view)->index(m_currentKey);
-        if (currentIndex.isValid()) {
-            m_view->selectionModel()->setCurrentIndex(currentIndex, QItemSelectionModel::NoUpdate);
-            m_view->scrollTo(currentIndex);
+    // don't override a selection that was made after the model change, e.g.
+    // by addKeysSelected() or by a dialog re-selecting groups; otherwise, add
+    // the previously selected keys to whatever is still selected
+    if (m_view->selectionModel()->selection() == m_selectionAfterModelChange) {
+        m_view->selectionModel()->select(itemSelectionFromKeys(m_selectedKeys, *m_view), QItemSelectionModel::Select | QItemSelectionModel::Rows);
+        if (!m_currentKey.isNull()) {
+            const QModelIndex currentIndex = keyListModel(*m_view)->index(m_currentKey);
+            if (currentIndex.isValid()) {
+                m_view->selectionModel()->setCurrentIndex(currentIndex, QItemSelectionModel::NoUpdate);
+                m_view->scrollTo(currentIndex);
+            }
         }
     }
+    m_selectionAfterModelChange.clear();
 
     setUpTagKeys();
     initializeColumnSizes();
@@ -11,6 +11,7 @@
 
 #include <QWidget>
 
+#include <QItemSelection>
 #include <QString>
 #include <QStringList>
 
@@ -32,6 +33,7 @@ class KeyFilter;
 class AbstractKeyListModel;
 class AbstractKeyListSortFilterProxyModel;
 class KeyListSortFilterProxyModel;
+class KeySearchFilterProxyModel;
 class SearchBar;
 
 class KeyTreeView : public QWidget
@@ -43,6 +45,8 @@ public:
     enum Option {
         Default = 0x0,
         NoDefaultContextMenu = 0x1,
+        /// share the results of the key filter with other views (see CachingKeyFilter)
+        CacheKeyFilterResults = 0x2,
     };
     Q_DECLARE_FLAGS(Options, Option)
 
@@ -148,11 +152,14 @@ private:
     void updateModelConnections(AbstractKeyListModel *oldModel, AbstractKeyListModel *newModel);
     void saveStateBeforeModelChange();
     void restoreStateAfterModelChange();
+    void restoreState();
+    std::shared_ptr<KeyFilter> proxyKeyFilter() const;
 
 private:
     std::vector<GpgME::Key> m_keys;
 
     KeyListSortFilterProxyModel *m_proxy;
+    KeySearchFilterProxyModel *m_searchProxy;
     AbstractKeyListSortFilterProxyModel *m_additionalProxy;
 
     TreeView *m_view;
@@ -166,6 +173,7 @@ private:
     QStringList m_expandedKeys;
     std::vector<GpgME::Key> m_selectedKeys;
     GpgME::Key m_currentKey;
+    QItemSelection m_selectionAfterModelChange;
 
     std::vector<QMetaObject::Connection> m_connections;
 
@@ -174,6 +182,8 @@ private:
     bool m_isHierarchical : 1;
     bool m_onceResized : 1;
     bool m_showDefaultContextMenu : 1;
+    bool m_cacheKeyFilterResults : 1;
+    bool m_stateRestoreScheduled : 1;
 };
 
 }
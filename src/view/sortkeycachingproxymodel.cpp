@@ -0,0 +1,211 @@
+/* -*- mode: c++; c-basic-offset:4 -*-
+    view/sortkeycachingproxymodel.cpp
+
+    This file is part of Kleopatra, the KDE keymanager
+    SPDX-FileCopyrightText: 2024 g10 Code GmbH
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <config-kleopatra.h>
+
+#include "sortkeycachingproxymodel.h"
+
+#include <QPointer>
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+using namespace Kleo;
+
+class SortKeyCachingProxyModel::Private
+{
+    friend class ::Kleo::SortKeyCachingProxyModel;
+    SortKeyCachingProxyModel *const q;
+
+public:
+    explicit Private(SortKeyCachingProxyModel *qq);
+
+private:
+    QVariant sortKey(const QModelIndex &index);
+    void dropSortKeys(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+    void clear();
+    void connectSourceModel(QAbstractItemModel *model);
+
+private:
+    // the sort keys of the rows below one parent (by row)
+    struct SortKeys {
+        std::vector<QVariant> values;
+        std::vector<bool> available;
+    };
+    // the sort keys of the column `column` by the internal id of the rows
+    std::unordered_map<quintptr, SortKeys> sortKeys;
+    int column = -1;
+    int role = -1;
+    Qt::CaseSensitivity caseSensitivity = Qt::CaseSensitive;
+    bool localeAware = false;
+
+    QPointer<QAbstractItemModel> sourceModel;
+    std::vector<QMetaObject::Connection> connections;
+};
+
+SortKeyCachingProxyModel::Private::Private(SortKeyCachingProxyModel *qq)
+    : q{qq}
+{
+}
+
+QVariant SortKeyCachingProxyModel::Private::sortKey(const QModelIndex &index)
+{
+    if (index.column() != column || q->sortRole() != role || q->sortCaseSensitivity() != caseSensitivity || q->isSortLocaleAware() != localeAware) {
+        clear();
+        column = index.column();
+        role = q->sortRole();
+        caseSensitivity = q->sortCaseSensitivity();
+        localeAware = q->isSortLocaleAware();
+    }
+    auto &keys = sortKeys[index.internalId()];
+    const auto row = static_cast<std::size_t>(index.row());
+    if (row >= keys.values.size()) {
+        keys.values.resize(row + 1);
+        keys.available.resize(row + 1, false);
+    }
+    if (!keys.available[row]) {
+        QVariant value = index.data(role);
+        if (value.typeId() == QMetaType::QString && caseSensitivity == Qt::CaseInsensitive && !localeAware) {
+            // fold the case once instead of in each comparison
+            value = value.toString().toCaseFolded();
+        }
+        keys.values[row] = std::move(value);
+        keys.available[row] = true;
+    }
+    return keys.values[row];
+}
+
+void SortKeyCachingProxyModel::Private::dropSortKeys(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    if (!topLeft.isValid() || column < topLeft.column() || column > bottomRight.column()) {
+        return;
+    }
+    const auto it = sortKeys.find(topLeft.internalId());
+    if (it == sortKeys.end()) {
+        return;
+    }
+    auto &available = it->second.available;
+    for (auto row = static_cast<std::size_t>(topLeft.row()), end = std::min<std::size_t>(bottomRight.row() + 1, available.size()); row < end; ++row) {
+        available[row] = false;
+    }
+}
+
+void SortKeyCachingProxyModel::Private::clear()
+{
+    sortKeys.clear();
+}
+
+void SortKeyCachingProxyModel::Private::connectSourceModel(QAbstractItemModel *model)
+{
+    for (const auto &connection : connections) {
+        QObject::disconnect(connection);
+    }
+    connections.clear();
+    clear();
+    sourceModel = model;
+    if (!model) {
+        return;
+    }
+    // these connections are made before QSortFilterProxyModel connects to
+    // the source model, so that the sort keys are up to date when the proxy
+    // model sorts the changed rows
+    connections = {
+        QObject::connect(model,
+                         &QAbstractItemModel::dataChanged,
+                         q,
+                         [this](const QModelIndex &topLeft, const QModelIndex &bottomRight) {
+                             dropSortKeys(topLeft, bottomRight);
+                         }),
+        QObject::connect(model,
+                         &QAbstractItemModel::rowsAboutToBeInserted,
+                         q,
+                         [this]() {
+                             clear();
+                         }),
+        QObject::connect(model,
+                         &QAbstractItemModel::rowsAboutToBeRemoved,
+                         q,
+                         [this]() {
+                             clear();
+                         }),
+        QObject::connect(model,
+                         &QAbstractItemModel::rowsAboutToBeMoved,
+                         q,
+                         [this]() {
+                             clear();
+                         }),
+        QObject::connect(model,
+                         &QAbstractItemModel::layoutAboutToBeChanged,
+                         q,
+                         [this]() {
+                             clear();
+                         }),
+        QObject::connect(model,
+                         &QAbstractItemModel::modelAboutToBeReset,
+                         q,
+                         [this]() {
+                             clear();
+                         }),
+    };
+}
+
+SortKeyCachingProxyModel::SortKeyCachingProxyModel(QObject *parent)
+    : KeyListSortFilterProxyModel{parent}
+    , d{new Private{this}}
+{
+}
+
+SortKeyCachingProxyModel::SortKeyCachingProxyModel(const SortKeyCachingProxyModel &other)
+    : KeyListSortFilterProxyModel{other}
+    , d{new Private{this}}
+{
+}
+
+SortKeyCachingProxyModel::~SortKeyCachingProxyModel() = default;
+
+SortKeyCachingProxyModel *SortKeyCachingProxyModel::clone() const
+{
+    return new SortKeyCachingProxyModel{*this};
+}
+
+void SortKeyCachingProxyModel::setSourceModel(QAbstractItemModel *sourceModel)
+{
+    if (sourceModel != d->sourceModel) {
+        d->connectSourceModel(sourceModel);
+    }
+    KeyListSortFilterProxyModel::setSourceModel(sourceModel);
+}
+
+bool SortKeyCachingProxyModel::lessThan(const QModelIndex &left, const QModelIndex &right) const
+{
+    const QVariant l = d->sortKey(left);
+    const QVariant r = d->sortKey(right);
+    // same order as QSortFilterProxyModel::lessThan
+    if (!l.isValid()) {
+        return false;
+    }
+    if (!r.isValid()) {
+        return true;
+    }
+    if (l.typeId() == QMetaType::QString || r.typeId() == QMetaType::QString) {
+        if (d->localeAware) {
+            return QString::localeAwareCompare(l.toString(), r.toString()) < 0;
+        }
+        // the case of the strings has already been folded if needed
+        return QString::compare(l.toString(), r.toString(), Qt::CaseSensitive) < 0;
+    }
+    const auto order = QVariant::compare(l, r);
+    if (order == QPartialOrdering::Unordered) {
+        return QString::compare(l.toString(), r.toString(), d->caseSensitivity) < 0;
+    }
+    return order == QPartialOrdering::Less;
+}
+
+#include "moc_sortkeycachingproxymodel.cpp"
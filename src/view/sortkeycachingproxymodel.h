@@ -0,0 +1,55 @@
+/* -*- mode: c++; c-basic-offset:4 -*-
+    view/sortkeycachingproxymodel.h
+
+    This file is part of Kleopatra, the KDE keymanager
+    SPDX-FileCopyrightText: 2024 g10 Code GmbH
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <Libkleo/KeyListSortFilterProxyModel>
+
+#include <memory>
+
+namespace Kleo
+{
+
+/**
+ * A KeyListSortFilterProxyModel that caches the sort keys of the source rows.
+ *
+ * QSortFilterProxyModel asks the source model for the data of both rows in
+ * each comparison. For the key list models this means formatting the values
+ * of the certificates again and again while sorting. This proxy model
+ * stores the sort key (i.e. the data for the sort role) of each row of the
+ * sort column in an array, so that each value is computed only once. The
+ * cached sort keys are dropped when the source model changes.
+ *
+ * The source model must give siblings the same internal id, which is the
+ * case for the flat and hierarchical key list models and for all
+ * QSortFilterProxyModels.
+ */
+class SortKeyCachingProxyModel : public KeyListSortFilterProxyModel
+{
+    Q_OBJECT
+protected:
+    SortKeyCachingProxyModel(const SortKeyCachingProxyModel &other);
+
+public:
+    explicit SortKeyCachingProxyModel(QObject *parent = nullptr);
+    ~SortKeyCachingProxyModel() override;
+
+    SortKeyCachingProxyModel *clone() const override;
+
+    void setSourceModel(QAbstractItemModel *sourceModel) override;
+
+protected:
+    bool lessThan(const QModelIndex &left, const QModelIndex &right) const override;
+
+private:
+    class Private;
+    const std::unique_ptr<Private> d;
+};
+
+}
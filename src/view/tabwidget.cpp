@@ -49,6 +49,7 @@
 #include <QVBoxLayout>
 
 #include <map>
+#include <optional>
 
 using namespace Kleo;
 using namespace GpgME;
@@ -137,6 +138,22 @@ public:
         return m_configGroup;
     }
 
+    bool isMaterialized() const
+    {
+        return m_isMaterialized;
+    }
+
+    /**
+     * Sets the models of the page and restores the column layout of the page.
+     * Until then the page doesn't filter or sort anything.
+     */
+    void materialize(AbstractKeyListModel *flatModel, AbstractKeyListModel *hierarchicalModel);
+
+    void setLayoutToRestore(const KConfigGroup &group)
+    {
+        m_layoutToRestore = group;
+    }
+
 Q_SIGNALS:
     void titleChanged(const QString &title);
 
@@ -152,7 +169,9 @@ private:
     bool m_canChangeStringFilter : 1;
     bool m_canChangeKeyFilter : 1;
     bool m_canChangeHierarchical : 1;
+    bool m_isMaterialized : 1;
     KConfigGroup m_configGroup;
+    std::optional<KConfigGroup> m_layoutToRestore;
 };
 } // anon namespace
 
@@ -166,6 +185,7 @@ Page::Page(const Page &other)
     , m_canChangeStringFilter(other.m_canChangeStringFilter)
     , m_canChangeKeyFilter(other.m_canChangeKeyFilter)
     , m_canChangeHierarchical(other.m_canChangeHierarchical)
+    , m_isMaterialized(other.m_isMaterialized)
     , m_configGroup(other.configGroup().config()->group(QUuid::createUuid().toString()))
 {
     init();
@@ -179,7 +199,7 @@ Page::Page(const QString &title,
            QWidget *parent,
            const KConfigGroup &group,
            KeyTreeView::Options options)
-    : KeyTreeView(text, KeyFilterManager::instance()->keyFilterByID(id), proxy, parent, group, options)
+    : KeyTreeView(text, KeyFilterManager::instance()->keyFilterByID(id), proxy, parent, group, options | KeyTreeView::CacheKeyFilterResults)
     , m_title(title)
     , m_toolTip(toolTip)
     , m_isTemporary(false)
@@ -188,6 +208,7 @@ Page::Page(const QString &title,
     , m_canChangeStringFilter(true)
     , m_canChangeKeyFilter(true)
     , m_canChangeHierarchical(true)
+    , m_isMaterialized(false)
     , m_configGroup(group)
 {
     init();
@@ -207,7 +228,7 @@ Page::Page(const KConfigGroup &group, KeyTreeView::Options options, QWidget *par
                   nullptr,
                   parent,
                   group,
-                  options)
+                  options | KeyTreeView::CacheKeyFilterResults)
     , m_title(group.readEntry(TITLE_ENTRY))
     , m_toolTip()
     , m_isTemporary(false)
@@ -216,6 +237,7 @@ Page::Page(const KConfigGroup &group, KeyTreeView::Options options, QWidget *par
     , m_canChangeStringFilter(!group.isEntryImmutable(STRING_FILTER_ENTRY))
     , m_canChangeKeyFilter(!group.isEntryImmutable(KEY_FILTER_ENTRY))
     , m_canChangeHierarchical(!group.isEntryImmutable(HIERARCHICAL_VIEW_ENTRY))
+    , m_isMaterialized(false)
     , m_configGroup(group)
 {
     init();
@@ -236,6 +258,25 @@ void Page::init()
 #endif
 }
 
+void Page::materialize(AbstractKeyListModel *flatModel, AbstractKeyListModel *hierarchicalModel)
+{
+    if (m_isMaterialized) {
+        return;
+    }
+    m_isMaterialized = true;
+    setFlatModel(flatModel);
+    setHierarchicalModel(hierarchicalModel);
+    if (m_layoutToRestore) {
+        QMetaObject::invokeMethod(
+            this,
+            [this, group = *m_layoutToRestore]() {
+                restoreLayout(group);
+            },
+            Qt::QueuedConnection);
+        m_layoutToRestore.reset();
+    }
+}
+
 Page::~Page()
 {
 }
@@ -477,6 +518,7 @@ private:
     }
 
     QTreeView *addView(Page *page, Page *columnReference);
+    void materialize(Page *page);
 
 private:
     AbstractKeyListModel *flatModel = nullptr;
@@ -584,7 +626,8 @@ void TabWidget::Private::slotContextMenu(const QPoint &p)
 
 void TabWidget::Private::currentIndexChanged(int index)
 {
-    const Page *const page = this->page(index);
+    Page *const page = this->page(index);
+    materialize(page);
     Q_EMIT q->currentViewChanged(page ? page->view() : nullptr);
     Q_EMIT q->keyFilterChanged(page ? page->keyFilter() : std::shared_ptr<KeyFilter>());
     Q_EMIT q->stringFilterChanged(page ? page->stringFilter() : QString());
@@ -758,7 +801,7 @@ void TabWidget::setFlatModel(AbstractKeyListModel *model)
     }
     d->flatModel = model;
     for (unsigned int i = 0, end = count(); i != end; ++i)
-        if (Page *const page = d->page(i)) {
+        if (Page *const page = d->page(i); page && page->isMaterialized()) {
             page->setFlatModel(model);
         }
 }
@@ -775,7 +818,7 @@ void TabWidget::setHierarchicalModel(AbstractKeyListModel *model)
     }
     d->hierarchicalModel = model;
     for (unsigned int i = 0, end = count(); i != end; ++i)
-        if (Page *const page = d->page(i)) {
+        if (Page *const page = d->page(i); page && page->isMaterialized()) {
             page->setHierarchicalModel(model);
         }
 }
@@ -1013,12 +1056,7 @@ QAbstractItemView *TabWidget::addView(const QString &title, const QString &id, c
     Page *page = new Page(title, id, text, nullptr, QString(), nullptr, group, d->keyTreeViewOptions);
     group.writeEntry(KEY_FILTER_ENTRY, id);
     group.sync();
-    QMetaObject::invokeMethod(
-        this,
-        [page, group]() {
-            page->restoreLayout(group);
-        },
-        Qt::QueuedConnection);
+    page->setLayoutToRestore(group);
     return d->addView(page, d->currentPage());
 }
 
@@ -1037,12 +1075,7 @@ QAbstractItemView *TabWidget::addView(const KConfigGroup &group, Options options
     } else {
         page = new Page(group, d->keyTreeViewOptions);
     }
-    QMetaObject::invokeMethod(
-        this,
-        [page, group]() {
-            page->restoreLayout(group);
-        },
-        Qt::QueuedConnection);
+    page->setLayoutToRestore(group);
     return d->addView(page, nullptr);
 }
 
@@ -1067,8 +1100,12 @@ QTreeView *TabWidget::Private::addView(Page *page, Page *columnReference)
         q->createActions(coll);
     }
 
-    page->setFlatModel(flatModel);
-    page->setHierarchicalModel(hierarchicalModel);
+    // the models of pages that are not shown are only set when the page is
+    // shown for the first time, so that restoring many tabs doesn't filter and
+    // sort the certificates for each of them
+    if (columnReference || tabWidget->count() == 0) {
+        materialize(page);
+    }
 
     connect(page, &Page::titleChanged, q, [this](const QString &text) {
         slotPageTitleChanged(text);
@@ -1117,6 +1154,13 @@ QTreeView *TabWidget::Private::addView(Page *page, Page *columnReference)
     return view;
 }
 
+void TabWidget::Private::materialize(Page *page)
+{
+    if (page) {
+        page->materialize(flatModel, hierarchicalModel);
+    }
+}
+
 static QStringList extractViewGroups(const KConfigGroup &config)
 {
     return config.readEntry("Tabs", QStringList());
@@ -0,0 +1,201 @@
+/*
+    This file is part of Kleopatra's test suite.
+    SPDX-FileCopyrightText: 2024 g10 Code GmbH
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+//
+// Usage: test_pipeiodevice [--mib <n>] [--chunk <bytes>]
+//
+// Measures the throughput of KDPipeIODevice and UnixPipeIODevice when
+// reading from and writing to a pipe. Like in Kleopatra, the devices are
+// created in the main thread and used by a worker thread.
+//
+
+#include <config-kleopatra.h>
+
+#include <utils/kdpipeiodevice.h>
+#include <utils/unixpipeiodevice.h>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QThread>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace Kleo;
+
+namespace
+{
+struct Options {
+    qint64 totalSize;
+    qint64 chunkSize;
+};
+
+// the other ends of the pipes are served with plain system calls
+static void feedPipe(int fd, qint64 totalSize)
+{
+    const std::vector<char> data(1024 * 1024, 'x');
+    qint64 written = 0;
+    while (written < totalSize) {
+        const ssize_t n = ::write(fd, data.data(), std::min<qint64>(data.size(), totalSize - written));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            perror("write");
+            break;
+        }
+        written += n;
+    }
+    ::close(fd);
+}
+
+static qint64 drainPipe(int fd)
+{
+    std::vector<char> data(1024 * 1024);
+    qint64 total = 0;
+    while (true) {
+        const ssize_t n = ::read(fd, data.data(), data.size());
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        total += n;
+    }
+    ::close(fd);
+    return total;
+}
+
+// runs fn in a worker thread while the main thread runs the event loop
+static void runInWorkerThread(const std::function<void()> &fn)
+{
+    std::unique_ptr<QThread> thread{QThread::create(fn)};
+    QObject::connect(thread.get(), &QThread::finished, qApp, &QCoreApplication::quit);
+    thread->start();
+    QCoreApplication::exec();
+    thread->wait();
+}
+
+static void report(const char *name, const char *direction, qint64 bytes, qint64 msecs)
+{
+    const double mib = bytes / (1024.0 * 1024.0);
+    std::printf("%-18s %-6s %10.0f MiB in %7lld ms: %8.1f MiB/s\n", name, direction, mib, static_cast<long long>(msecs), msecs ? mib * 1000 / msecs : 0.0);
+}
+
+template<typename T_Device>
+static void benchmarkRead(const char *name, const Options &options)
+{
+    int fds[2];
+    if (::pipe(fds) != 0) {
+        perror("pipe");
+        return;
+    }
+    T_Device device;
+    if (!device.open(fds[0], QIODevice::ReadOnly)) {
+        std::fprintf(stderr, "%s: failed to open the read end of the pipe\n", name);
+        return;
+    }
+    std::thread feeder{feedPipe, fds[1], options.totalSize};
+
+    qint64 total = 0;
+    QElapsedTimer timer;
+    timer.start();
+    runInWorkerThread([&]() {
+        std::vector<char> buffer(options.chunkSize);
+        while (true) {
+            const qint64 n = device.read(buffer.data(), buffer.size());
+            if (n <= 0) {
+                break;
+            }
+            total += n;
+        }
+    });
+    const qint64 elapsed = timer.elapsed();
+    feeder.join();
+    device.close();
+
+    if (total != options.totalSize) {
+        std::fprintf(stderr, "%s: read %lld bytes instead of %lld bytes\n", name, static_cast<long long>(total), static_cast<long long>(options.totalSize));
+    }
+    report(name, "read", total, elapsed);
+}
+
+template<typename T_Device>
+static void benchmarkWrite(const char *name, const Options &options)
+{
+    int fds[2];
+    if (::pipe(fds) != 0) {
+        perror("pipe");
+        return;
+    }
+    auto device = std::make_unique<T_Device>();
+    if (!device->open(fds[1], QIODevice::WriteOnly)) {
+        std::fprintf(stderr, "%s: failed to open the write end of the pipe\n", name);
+        return;
+    }
+    qint64 drained = 0;
+    std::thread drainer{[&drained, fd = fds[0]]() {
+        drained = drainPipe(fd);
+    }};
+
+    QElapsedTimer timer;
+    timer.start();
+    runInWorkerThread([&]() {
+        const std::vector<char> buffer(options.chunkSize, 'x');
+        qint64 written = 0;
+        while (written < options.totalSize) {
+            const qint64 n = device->write(buffer.data(), std::min<qint64>(buffer.size(), options.totalSize - written));
+            if (n <= 0) {
+                break;
+            }
+            written += n;
+        }
+        device->waitForBytesWritten(-1);
+    });
+    // closing the device closes the pipe, so that the drainer sees EOF
+    device->close();
+    drainer.join();
+    const qint64 elapsed = timer.elapsed();
+
+    if (drained != options.totalSize) {
+        std::fprintf(stderr, "%s: wrote %lld bytes instead of %lld bytes\n", name, static_cast<long long>(drained), static_cast<long long>(options.totalSize));
+    }
+    report(name, "write", drained, elapsed);
+}
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption({QStringLiteral("mib"), QStringLiteral("Number of MiB to transfer (default: 4096)."), QStringLiteral("n"), QStringLiteral("4096")});
+    parser.addOption({QStringLiteral("chunk"), QStringLiteral("Size of the reads and writes in bytes (default: 8192)."), QStringLiteral("bytes"), QStringLiteral("8192")});
+    parser.process(app);
+
+    const Options options{
+        parser.value(QStringLiteral("mib")).toLongLong() * 1024 * 1024,
+        std::max(1LL, parser.value(QStringLiteral("chunk")).toLongLong()),
+    };
+
+    benchmarkRead<KDPipeIODevice>("KDPipeIODevice", options);
+    benchmarkRead<UnixPipeIODevice>("UnixPipeIODevice", options);
+    benchmarkWrite<KDPipeIODevice>("KDPipeIODevice", options);
+    benchmarkWrite<UnixPipeIODevice>("UnixPipeIODevice", options);
+
+    return 0;
+}
@@ -0,0 +1,164 @@
+/*
+    This file is part of Kleopatra's test suite.
+    SPDX-FileCopyrightText: 2024 g10 Code GmbH
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+//
+// Usage: test_taskprogress [--tasks <n>] [--updates <n>] [--seconds <n>]
+//
+// Compares the summing of the progress of all tasks on every progress update
+// (as TaskCollection used to do) with the incremental aggregation of
+// TaskProgressAggregator. Then counts how many progress updates are
+// published by the RateLimiter used by TaskCollection while synthetic tasks
+// report progress as fast as possible.
+//
+
+#include <config-kleopatra.h>
+
+#include <crypto/taskprogressaggregator.h>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+#include <QTimer>
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+using namespace Kleo::Crypto;
+
+namespace
+{
+struct Options {
+    int numTasks;
+    qint64 numUpdates;
+    int seconds;
+};
+
+struct Update {
+    int task;
+    quint64 processed;
+};
+
+// progress updates of random tasks; each task has a total of 1000
+static std::vector<Update> makeUpdates(const Options &options)
+{
+    std::vector<Update> updates;
+    updates.reserve(options.numUpdates);
+    std::vector<quint64> processed(options.numTasks, 0);
+    auto random = QRandomGenerator::global();
+    for (qint64 i = 0; i < options.numUpdates; ++i) {
+        const int task = random->bounded(options.numTasks);
+        processed[task] = std::min<quint64>(processed[task] + 1, 1000);
+        updates.push_back({task, processed[task]});
+    }
+    return updates;
+}
+
+static void report(const char *name, qint64 numUpdates, qint64 msecs, quint64 checksum)
+{
+    std::printf("%-24s %10lld updates in %7lld ms: %12.0f updates/s (checksum %llu)\n",
+                name,
+                static_cast<long long>(numUpdates),
+                static_cast<long long>(msecs),
+                msecs ? numUpdates * 1000.0 / msecs : 0.0,
+                static_cast<unsigned long long>(checksum));
+}
+
+static void benchmarkSumming(const Options &options, const std::vector<Update> &updates)
+{
+    struct Progress {
+        quint64 processed = 0;
+        quint64 total = 1000;
+    };
+    std::vector<Progress> tasks(options.numTasks);
+    quint64 checksum = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (const auto &update : updates) {
+        tasks[update.task].processed = update.processed;
+        quint64 processed = 0;
+        quint64 total = 0;
+        for (const auto &task : tasks) {
+            processed += task.processed;
+            total += task.total;
+        }
+        checksum += processed * 1000 / total;
+    }
+    report("summing all tasks", updates.size(), timer.elapsed(), checksum);
+}
+
+static void benchmarkAggregation(const Options &options, const std::vector<Update> &updates)
+{
+    TaskProgressAggregator aggregator;
+    for (int task = 0; task < options.numTasks; ++task) {
+        aggregator.addTask(task);
+        aggregator.setProgress(task, 0, 1000);
+    }
+    quint64 checksum = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (const auto &update : updates) {
+        aggregator.setProgress(update.task, update.processed, 1000);
+        checksum += aggregator.processed() * 1000 / aggregator.total();
+    }
+    report("TaskProgressAggregator", updates.size(), timer.elapsed(), checksum);
+}
+
+static void benchmarkRateLimiting(const Options &options)
+{
+    RateLimiter rateLimiter{20};
+    qint64 numRequests = 0;
+    qint64 numEmissions = 0;
+    QObject::connect(&rateLimiter, &RateLimiter::triggered, [&numEmissions]() {
+        numEmissions++;
+    });
+    // report progress in bursts, like the tasks do when gpg reports progress
+    // for many files in quick succession
+    QTimer updateTimer;
+    QObject::connect(&updateTimer, &QTimer::timeout, [&]() {
+        for (int i = 0; i < 100; ++i) {
+            numRequests++;
+            rateLimiter.request();
+        }
+    });
+    updateTimer.start(0);
+    QTimer::singleShot(options.seconds * 1000, qApp, &QCoreApplication::quit);
+    QCoreApplication::exec();
+    rateLimiter.flush();
+    std::printf("%-24s %10lld progress updates in %d s resulted in %lld emissions\n",
+                "RateLimiter",
+                static_cast<long long>(numRequests),
+                options.seconds,
+                static_cast<long long>(numEmissions));
+}
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    parser.addOption({QStringLiteral("tasks"), QStringLiteral("Number of tasks (default: 10000)."), QStringLiteral("n"), QStringLiteral("10000")});
+    parser.addOption({QStringLiteral("updates"), QStringLiteral("Number of progress updates (default: 100000)."), QStringLiteral("n"), QStringLiteral("100000")});
+    parser.addOption({QStringLiteral("seconds"), QStringLiteral("Duration of the rate limiting test (default: 2)."), QStringLiteral("n"), QStringLiteral("2")});
+    parser.process(app);
+
+    const Options options{
+        std::max(1, parser.value(QStringLiteral("tasks")).toInt()),
+        std::max(1LL, parser.value(QStringLiteral("updates")).toLongLong()),
+        std::max(1, parser.value(QStringLiteral("seconds")).toInt()),
+    };
+
+    const auto updates = makeUpdates(options);
+    benchmarkSumming(options, updates);
+    benchmarkAggregation(options, updates);
+    benchmarkRateLimiting(options);
+
+    return 0;
+}